@@ -0,0 +1,115 @@
+#ifndef StPicoEABtowGeometry_h
+#define StPicoEABtowGeometry_h
+
+// ROOT headers
+#include "Rtypes.h"
+
+//________________
+/// Geometry of the 4800 BEMC towers (BTOW) in terms of the tower index
+/// (softId - 1, the index of the StPicoBTowHit array and of
+/// StPicoTrack::bemcTowerIndex()).
+///
+/// softId = 40*(module-1) + 20*(sub-1) + etaBin + 1, where modules 1-60
+/// cover the west half (eta > 0) and modules 61-120 the east half, etaBin
+/// counts 0.05 wide bins away from eta = 0 and each module has two phi
+/// columns (sub). Towers are mapped to a global grid of 40 eta rows
+/// (etaRow 0 at eta = -1, 39 at eta = +1) and 120 phi columns, in which
+/// neighbours are adjacent cells; phi wraps around, eta does not.
+///
+/// All mappings are constexpr. The table of the 8 neighbours of every
+/// tower is filled once on first use (neighbours(), -1 for no neighbour).
+class StPicoEABtowGeometry {
+
+ public:
+  /// Number of towers, eta rows and phi columns
+  static constexpr Int_t kNTowers = 4800;
+  static constexpr Int_t kNEtaRows = 40;
+  static constexpr Int_t kNPhiColumns = 120;
+  /// Maximal number of neighbours of a tower
+  static constexpr Int_t kNNeighbours = 8;
+
+  /// Module (1-120) of the tower index
+  static constexpr Int_t module(Int_t index)    { return index / 40 + 1; }
+  /// Phi column inside the module (1-2)
+  static constexpr Int_t sub(Int_t index)       { return (index % 40) / 20 + 1; }
+  /// |eta| bin (0-19)
+  static constexpr Int_t etaBin(Int_t index)    { return index % 20; }
+  /// Tower is on the west (eta > 0) side
+  static constexpr Bool_t isWest(Int_t index)   { return index < kNTowers / 2; }
+
+  /// Global eta row (0-39)
+  static constexpr Int_t etaRow(Int_t index)
+  { return isWest(index) ? kNEtaRows / 2 + etaBin(index) : kNEtaRows / 2 - 1 - etaBin(index); }
+  /// Global phi column (0-119)
+  static constexpr Int_t phiColumn(Int_t index)
+  { return isWest(index) ?
+      wrapPhi( 25 - ( 2 * (module(index) - 1) + sub(index) - 1 ) ) :
+      wrapPhi( 34 + 2 * (module(index) - 61) + sub(index) - 1 ); }
+
+  /// Tower index of the global eta row and phi column (-1 outside the barrel)
+  static constexpr Int_t index(Int_t etaRow, Int_t phiColumn)
+  { return ( etaRow < 0 || etaRow >= kNEtaRows ) ? -1 :
+      ( etaRow >= kNEtaRows / 2 ) ?
+      indexOf( westModuleColumn( wrapPhi(phiColumn) ) / 2 + 1,
+               westModuleColumn( wrapPhi(phiColumn) ) % 2 + 1, etaRow - kNEtaRows / 2 ) :
+      indexOf( eastModuleColumn( wrapPhi(phiColumn) ) / 2 + 61,
+               eastModuleColumn( wrapPhi(phiColumn) ) % 2 + 1, kNEtaRows / 2 - 1 - etaRow ); }
+
+  /// Tower index shifted by dEta rows and dPhi columns (-1 outside the barrel)
+  static constexpr Int_t neighbour(Int_t index, Int_t dEta, Int_t dPhi)
+  { return StPicoEABtowGeometry::index( etaRow(index) + dEta, phiColumn(index) + dPhi ); }
+
+  /// The 8 neighbours (3x3 without the tower itself) of the tower index
+  /// 0-4799. Entries are -1 at the eta edges of the barrel
+  static const Int_t* neighbours(Int_t index);
+
+ private:
+  /// Phi column in [0, 120)
+  static constexpr Int_t wrapPhi(Int_t phi)
+  { return ( phi % kNPhiColumns + kNPhiColumns ) % kNPhiColumns; }
+  /// Column counted inside the west/east half: 2*(module-1) + sub-1
+  static constexpr Int_t westModuleColumn(Int_t phi) { return wrapPhi(25 - phi); }
+  static constexpr Int_t eastModuleColumn(Int_t phi) { return wrapPhi(phi - 34); }
+  /// Tower index from module, sub and etaBin
+  static constexpr Int_t indexOf(Int_t module, Int_t sub, Int_t etaBin)
+  { return 40 * (module - 1) + 20 * (sub - 1) + etaBin; }
+};
+
+//________________
+inline const Int_t* StPicoEABtowGeometry::neighbours(Int_t index) {
+
+  // Filled on the first call (thread-safe initialization of local statics)
+  struct Table {
+    Int_t value[kNTowers][kNNeighbours];
+    Table() {
+      for (Int_t iTow=0; iTow<kNTowers; iTow++) {
+        Int_t iNb = 0;
+        for (Int_t dEta=-1; dEta<=1; dEta++) {
+          for (Int_t dPhi=-1; dPhi<=1; dPhi++) {
+            if ( dEta == 0 && dPhi == 0 ) continue;
+            value[iTow][iNb++] = neighbour(iTow, dEta, dPhi);
+          }
+        }
+      }
+    }
+  };
+  static const Table table;
+  return table.value[index];
+}
+
+// Consistency of the mappings is checked at compile time
+static_assert( StPicoEABtowGeometry::index( StPicoEABtowGeometry::etaRow(0),
+                                            StPicoEABtowGeometry::phiColumn(0) ) == 0,
+               "BTOW tower 1 mapping" );
+static_assert( StPicoEABtowGeometry::index( StPicoEABtowGeometry::etaRow(2419),
+                                            StPicoEABtowGeometry::phiColumn(2419) ) == 2419,
+               "BTOW tower 2420 mapping" );
+static_assert( StPicoEABtowGeometry::index( StPicoEABtowGeometry::etaRow(4799),
+                                            StPicoEABtowGeometry::phiColumn(4799) ) == 4799,
+               "BTOW tower 4800 mapping" );
+static_assert( StPicoEABtowGeometry::neighbour(20, 0, 1) == 0,
+               "BTOW phi neighbour inside a module" );
+static_assert( StPicoEABtowGeometry::neighbour(0, -1, 0) == 4620,
+               "BTOW eta neighbour across eta = 0" );
+
+#endif // StPicoEABtowGeometry_h
@@ -0,0 +1,167 @@
+// C++ headers
+#include <iostream>
+#include <algorithm>
+
+// ROOT headers
+#include "TDirectory.h"
+#include "TTree.h"
+
+// StPicoEASkimmer headers
+#include "StPicoEARunIndex.h"
+
+//________________
+StPicoEARunIndex::StPicoEARunIndex() : mSegments() {
+  /* empty */
+}
+
+//________________
+StPicoEARunIndex::~StPicoEARunIndex() {
+  /* empty */
+}
+
+//________________
+void StPicoEARunIndex::fill(Int_t runId, Int_t runIndex, Long64_t entry,
+                            const std::vector<unsigned int>& triggerIds) {
+
+  // Start a new segment when the run changes
+  if ( mSegments.empty() || mSegments.back().runId != runId ) {
+    StPicoEARunSegment segment;
+    segment.runId = runId;
+    segment.runIndex = runIndex;
+    segment.firstEntry = entry;
+    segment.nEntries = 0;
+    mSegments.push_back(segment);
+  }
+
+  StPicoEARunSegment &segment = mSegments.back();
+  segment.nEntries++;
+  for (unsigned int iTrg=0; iTrg<triggerIds.size(); iTrg++) {
+    std::vector<unsigned int>::iterator it =
+      std::find(segment.triggerIds.begin(), segment.triggerIds.end(), triggerIds[iTrg]);
+    if ( it == segment.triggerIds.end() ) {
+      segment.triggerIds.push_back( triggerIds[iTrg] );
+      segment.triggerCounts.push_back(1);
+    }
+    else {
+      segment.triggerCounts[ it - segment.triggerIds.begin() ]++;
+    }
+  }
+}
+
+//________________
+void StPicoEARunIndex::append(const StPicoEARunIndex& other) {
+
+  Long64_t offset = numberOfEntries();
+  for (unsigned int iSeg=0; iSeg<other.mSegments.size(); iSeg++) {
+    mSegments.push_back( other.mSegments[iSeg] );
+    mSegments.back().firstEntry = offset;
+    offset += other.mSegments[iSeg].nEntries;
+  }
+}
+
+//________________
+void StPicoEARunIndex::write(TDirectory *dir, const char* name) const {
+
+  if ( !dir ) return;
+
+  TDirectory *saveDir = gDirectory;
+  dir->cd();
+
+  Int_t runId = 0;
+  Int_t runIndex = 0;
+  Long64_t firstEntry = 0;
+  Long64_t nEntries = 0;
+  std::vector<unsigned int> triggerIds;
+  std::vector<int> triggerCounts;
+
+  TTree *tree = new TTree(name, "Entry ranges of the runs in the skim tree");
+  tree->Branch("runId", &runId, "runId/I");
+  tree->Branch("runIndex", &runIndex, "runIndex/I");
+  tree->Branch("firstEntry", &firstEntry, "firstEntry/L");
+  tree->Branch("nEntries", &nEntries, "nEntries/L");
+  tree->Branch("triggerIds", &triggerIds);
+  tree->Branch("triggerCounts", &triggerCounts);
+
+  for (unsigned int iSeg=0; iSeg<mSegments.size(); iSeg++) {
+    const StPicoEARunSegment &segment = mSegments[iSeg];
+    runId = segment.runId;
+    runIndex = segment.runIndex;
+    firstEntry = segment.firstEntry;
+    nEntries = segment.nEntries;
+    triggerIds = segment.triggerIds;
+    triggerCounts = segment.triggerCounts;
+    tree->Fill();
+  }
+
+  tree->Write(nullptr, TObject::kOverwrite);
+  delete tree;
+  saveDir->cd();
+}
+
+//________________
+Bool_t StPicoEARunIndex::read(TTree *tree) {
+
+  mSegments.clear();
+  if ( !tree ) {
+    std::cerr << "StPicoEARunIndex::read - no RunIndex tree" << std::endl;
+    return false;
+  }
+
+  Int_t runId = 0;
+  Int_t runIndex = 0;
+  Long64_t nEntries = 0;
+  std::vector<unsigned int> *triggerIds = nullptr;
+  std::vector<int> *triggerCounts = nullptr;
+  tree->SetBranchAddress("runId", &runId);
+  tree->SetBranchAddress("runIndex", &runIndex);
+  tree->SetBranchAddress("nEntries", &nEntries);
+  tree->SetBranchAddress("triggerIds", &triggerIds);
+  tree->SetBranchAddress("triggerCounts", &triggerCounts);
+
+  // Stored firstEntry is local to the job output: use the running sum
+  Long64_t firstEntry = 0;
+  for (Long64_t iEntry=0; iEntry<tree->GetEntries(); iEntry++) {
+    tree->GetEntry(iEntry);
+    StPicoEARunSegment segment;
+    segment.runId = runId;
+    segment.runIndex = runIndex;
+    segment.firstEntry = firstEntry;
+    segment.nEntries = nEntries;
+    if (triggerIds) segment.triggerIds = *triggerIds;
+    if (triggerCounts) segment.triggerCounts = *triggerCounts;
+    mSegments.push_back(segment);
+    firstEntry += nEntries;
+  }
+
+  tree->ResetBranchAddresses();
+  delete triggerIds;
+  delete triggerCounts;
+  return true;
+}
+
+//________________
+std::vector<StPicoEARunSegment> StPicoEARunIndex::segmentsOfRun(Int_t runId) const {
+  std::vector<StPicoEARunSegment> result;
+  for (unsigned int iSeg=0; iSeg<mSegments.size(); iSeg++) {
+    if ( mSegments[iSeg].runId == runId ) result.push_back( mSegments[iSeg] );
+  }
+  return result;
+}
+
+//________________
+Long64_t StPicoEARunIndex::numberOfEntries(Int_t runId) const {
+  Long64_t nEntries = 0;
+  for (unsigned int iSeg=0; iSeg<mSegments.size(); iSeg++) {
+    if ( mSegments[iSeg].runId == runId ) nEntries += mSegments[iSeg].nEntries;
+  }
+  return nEntries;
+}
+
+//________________
+Long64_t StPicoEARunIndex::numberOfEntries() const {
+  Long64_t nEntries = 0;
+  for (unsigned int iSeg=0; iSeg<mSegments.size(); iSeg++) {
+    nEntries += mSegments[iSeg].nEntries;
+  }
+  return nEntries;
+}
@@ -0,0 +1,86 @@
+#ifndef StPicoEARunIndex_h
+#define StPicoEARunIndex_h
+
+// C++ headers
+#include <vector>
+
+// ROOT headers
+#include "Rtypes.h"
+
+//
+// Forward declarations
+//
+
+class TDirectory;
+class TTree;
+
+//________________
+/// Contiguous range of the skim tree entries that belong to one run
+struct StPicoEARunSegment {
+  /// Run ID
+  Int_t runId;
+  /// Chronological run index (see StPicoEASkimmer::LoadRunIndexMap)
+  Int_t runIndex;
+  /// First entry of the segment in the skim tree
+  Long64_t firstEntry;
+  /// Number of entries in the segment
+  Long64_t nEntries;
+  /// Accepted trigger IDs that fired in the segment
+  std::vector<unsigned int> triggerIds;
+  /// Number of entries that fired the corresponding trigger ID
+  std::vector<int> triggerCounts;
+};
+
+//________________
+/// Run index table of a skim tree. The skimmer records one segment per
+/// contiguous block of entries from the same run and writes the table as
+/// a small TTree (RunIndex) next to the skim tree.
+///
+/// The table keeps its meaning after hadd: both trees are concatenated in
+/// the same order and the segments cover the skim tree without gaps, so
+/// read() recomputes the entry ranges from the running sum of nEntries.
+/// The class does not depend on STAR libraries and can be compiled in
+/// plain ROOT, e.g. .L StPicoEARunIndex.cxx+
+class StPicoEARunIndex {
+
+ public:
+  /// Constructor
+  StPicoEARunIndex();
+  /// Destructor
+  virtual ~StPicoEARunIndex();
+
+  /// Remove all segments
+  void clear()                                          { mSegments.clear(); }
+  /// Register the skim tree entry that is about to be filled
+  /// \param entry Entry number of the event in the skim tree
+  /// \param triggerIds Accepted trigger IDs of the event
+  void fill(Int_t runId, Int_t runIndex, Long64_t entry,
+            const std::vector<unsigned int>& triggerIds);
+  /// Append the table of the following part of the skim tree (e.g. the
+  /// next file of a merge). Its entry ranges are shifted accordingly
+  void append(const StPicoEARunIndex& other);
+  /// Write the table as TTree with the given name to the directory.
+  /// A table written earlier under the same name is overwritten
+  void write(TDirectory *dir, const char* name = "RunIndex") const;
+  /// Read the table from a (possibly merged) RunIndex tree. Entry ranges
+  /// are recomputed, so they refer to the (possibly merged) skim tree
+  Bool_t read(TTree *tree);
+
+  /// All segments
+  const std::vector<StPicoEARunSegment>& segments() const { return mSegments; }
+  /// Number of segments
+  unsigned int numberOfSegments() const                 { return mSegments.size(); }
+  /// Segments of the given run. After merging a run may be split
+  /// into several segments
+  std::vector<StPicoEARunSegment> segmentsOfRun(Int_t runId) const;
+  /// Number of skim tree entries of the given run
+  Long64_t numberOfEntries(Int_t runId) const;
+  /// Total number of skim tree entries covered by the table
+  Long64_t numberOfEntries() const;
+
+ private:
+  /// List of segments ordered as the skim tree entries
+  std::vector<StPicoEARunSegment> mSegments;
+};
+
+#endif // #define StPicoEARunIndex_h
@@ -1,11 +1,14 @@
-// STAR headers
-#include "St_base/StMessMgr.h"
+// STAR headers (StMessMgr, or std::cout with _VANILLA_ROOT_)
+#include "StPicoEvent/StPicoMessMgr.h"
 
 // StPicoEASkimmer headers
 #include "StPicoEASkimmer.h"
+#include "StPicoEABtowGeometry.h"
 
-// StPicoDstMaker headers
+// StPicoDstMaker headers (not in the standalone build)
+#if !defined(_VANILLA_ROOT_)
 #include "StPicoDstMaker/StPicoDstMaker.h"
+#endif
 // StPicoEvent headers
 #include "StPicoEvent/StPicoDst.h"
 #include "StPicoEvent/StPicoDstReader.h"
@@ -18,23 +21,77 @@
 
 // ROOT headers
 #include "TChain.h"
+#include "TChainElement.h"
+#include "TSystem.h"
+#include "TDirectory.h"
 #include "TFile.h"
+#include "TTree.h"
+#include "TNamed.h"
 #include "TH1F.h"
 #include "TH1D.h"
 #include "TH2F.h"
 #include "TVector3.h"
+#include "TVector2.h"
 #include "TMath.h"
 
 // C++ headers
 #include <limits>
 #include <iostream>
 #include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
 
 ClassImp(StPicoEASkimmer)
 
+// Values of the configuration file
+namespace {
+
+  /// Number that spans the whole token
+  Bool_t ConfigNumber(const std::string &token, Double_t &value) {
+    const char *begin = token.c_str();
+    char *end = nullptr;
+    value = std::strtod(begin, &end);
+    return ( end != begin && *end == '\0' );
+  }
+
+  /// Integer that spans the whole token
+  Bool_t ConfigInteger(const std::string &token, Long64_t &value) {
+    const char *begin = token.c_str();
+    char *end = nullptr;
+    value = std::strtoll(begin, &end, 10);
+    return ( end != begin && *end == '\0' );
+  }
+
+  /// Integer IDs of a list file (whitespace separated, # comments)
+  Bool_t ReadIdList(const char *fileName, std::vector<Int_t> &ids) {
+    std::ifstream in(fileName);
+    if ( !in ) return false;
+    std::string line, token;
+    while ( std::getline(in, line) ) {
+      std::string::size_type comment = line.find('#');
+      if ( comment != std::string::npos ) line.erase(comment);
+      std::istringstream tokens(line);
+      while ( tokens >> token ) {
+        Long64_t id = 0;
+        if ( !ConfigInteger(token, id) ) return false;
+        ids.push_back( (Int_t)id );
+      }
+    }
+    return true;
+  }
+
+  /// Flag: 1/0, true/false, on/off
+  Bool_t ConfigFlag(const std::string &token, Bool_t &value) {
+    if ( token == "1" || token == "true" || token == "on" ) { value = true; return true; }
+    if ( token == "0" || token == "false" || token == "off" ) { value = false; return true; }
+    return false;
+  }
+}
+
 //________________
 StPicoEASkimmer::StPicoEASkimmer(StPicoDstMaker *maker, const char* oFileName)
-  : StMaker(), mDebug(false), mOutFileName(oFileName), mOutFile(nullptr),
+  : StMaker(), mDebug(false), mFillQA(true), mOutFileName(oFileName), mOutFile(nullptr),
     mPicoDstMaker(maker), mPicoDstReader(nullptr), mPicoDst(nullptr),
     mEventCounter(0), mIsFromMaker(true) {
   // Constructor
@@ -76,12 +133,91 @@ StPicoEASkimmer::StPicoEASkimmer(StPicoDstMaker *maker, const char* oFileName)
   mTreeCutPt[0] = 0.15; mTreeCutPt[1] = 10.;
   mTreeCutEta[0] = -1.2; mTreeCutEta[1] = 1.2;
   mTreeCutDCA[0] = 0.; mTreeCutDCA[1] = 1000.;
+
+  // Event-activity observables: any leading track, all tree tracks counted
+  mEALeadPtMin = 0.;
+  mEAPt[0] = 0.2; mEAPt[1] = 50.;
+
+  // Main tree is written by default, no trigger streams
+  mEATree = nullptr;
+  mWriteMainTree = true;
+  mStreams.clear();
+
+  // No checkpoints and no wall-clock limit by default
+  mCheckpointInterval = 0;
+  mCheckpointFileName = "";
+  mWallClockBudget = -1.;
+  mWallClockMargin = 600.;
+  mIsStoppedOnBudget = false;
+  mIsEndOfInput = false;
+  mResume = false;
+  mResumeCount = 0;
+
+  // Input in the given order, no run seen yet
+  mSortInputByRun = false;
+  mCurrentRunId = -1;
+  mCurrentRunIndex = -1;
+  mNRunChanges = 0;
+
+  // No bad runs and towers by default
+  mIsBadRun = false;
+  mNBadRunEvents = 0;
+  mBadTowers.reset();
+  mNBadTowerTracks = 0;
+  mNBadTowerHts = 0;
+
+  // HT matching of the track tower only
+  mHtMatchNeighbours = false;
+
+  // No V0 finding by default
+  mFindV0 = false;
+
+  // No vertex refit by default
+  mVertexRefit = false;
+  mIsVertexRefitted = false;
+  mNVertexRefits = 0;
+  mNVertexRefitsFailed = 0;
+  mNVertexRefitsNoCov = 0;
+  mVtxRefitX = mVtxRefitY = mVtxRefitZ = -9999.f;
+  mVtxRefitErrorX = mVtxRefitErrorY = mVtxRefitErrorZ = -9999.f;
+  mVtxRefitChi2Ndf = -9999.f;
+  mVtxRefitSumW = 0.f;
+
+  // One output file by default
+  mMaxOutputSize = 0;
+  mMaxEntriesPerFile = 0;
+  mOutFileStem = "";
+  mOutFilePart = 0;
+
+  // No augmentation by default
+  mAugmentFileName = "";
+  mAugmentTreeName = "EATree";
+  mAugmentFile = nullptr;
+  mAugmentTree = nullptr;
+  mFriendTree = nullptr;
+  mAugmentEntry = 0;
+  mAugmentNMismatches = 0;
+  mAugmentHasRunId = false;
+  mAugmentEventID = 0;
+  mAugmentRunId = 0;
+  mAugmentTrackPt = nullptr;
+}
+
+//________________
+StPicoEASkimmer::StPicoEASkimmer(const char* inFileName, const char* oFileName)
+  : StPicoEASkimmer((StPicoDstMaker*)nullptr, oFileName) {
+  // Constructor: the input is read by the skimmer itself
+
+  mPicoDstReader = new StPicoDstReader(inFileName);
+  mIsFromMaker = false;
 }
 
 //________________
 StPicoEASkimmer::~StPicoEASkimmer() {
   // Destructor
-  /* empty */
+  if (mPicoDstReader) {
+    delete mPicoDstReader;
+  }
 }
 
 //________________
@@ -92,12 +228,86 @@ Int_t StPicoEASkimmer::Init() {
     LOG_INFO << "Initializing StPicoEASkimmer..." << endm;
   }
 
+  // Cuts and options from the configuration file override the setters
+  if ( !mConfigFileName.IsNull() && !ReadConfigFile() ) {
+    LOG_ERROR << "Invalid configuration file " << mConfigFileName << ". Terminating." << endm;
+    return kStErr;
+  }
+
+  // The state file is needed for checkpoints, the budget and for resuming
+  if ( mCheckpointFileName.IsNull() &&
+       ( mCheckpointInterval > 0 || mWallClockBudget > 0 || mResume ) ) {
+    mCheckpointFileName = mOutFileName + ".state";
+  }
+
+  // Entries of the friend tree follow the skim entries from the start
+  if ( mResume && !mAugmentFileName.IsNull() ) {
+    LOG_WARN << "Resume mode is not supported for augmentation. It is switched off" << endm;
+    mResume = false;
+  }
+
+  // Resume: continue after the last checkpoint into a new output file
+  if ( mResume ) {
+    if ( mIsFromMaker ) {
+      LOG_WARN << "Resume mode needs StPicoDstReader. It is ignored with StPicoDstMaker" << endm;
+    }
+    else if ( !gSystem->AccessPathName( mCheckpointFileName.Data() ) ) {
+      std::ifstream stateStream( mCheckpointFileName.Data() );
+      std::string key;
+      while ( stateStream >> key ) {
+        if ( key == "resumeCount" ) stateStream >> mResumeCount;
+        else stateStream.ignore( std::numeric_limits<std::streamsize>::max(), '\n' );
+      }
+      mResumeCount++;
+      mPicoDstReader->setResumeFile( mCheckpointFileName.Data() );
+
+      TString stem = mOutFileName;
+      if ( stem.EndsWith(".root") ) stem.Resize( stem.Length() - 5 );
+      mOutFileName = Form("%s_resume%d.root", stem.Data(), mResumeCount);
+      LOG_INFO << "Resuming from " << mCheckpointFileName << ". Output goes to "
+               << mOutFileName << endm;
+    }
+  }
+
+  // Bad runs by run index
+  mBadRunMask.clear();
+  if ( !mBadRunIds.empty() ) {
+    if ( mRunIndexMap.empty() ) {
+      LOG_ERROR << "The bad run list needs the run index map. Terminating." << endm;
+      return kStErr;
+    }
+    Int_t nRunIndices = 0;
+    for (std::map<int, int>::const_iterator it = mRunIndexMap.begin(); it != mRunIndexMap.end(); ++it) {
+      nRunIndices = std::max( nRunIndices, it->second + 1 );
+    }
+    mBadRunMask.assign( nRunIndices, false );
+    for (unsigned int iRun=0; iRun<mBadRunIds.size(); iRun++) {
+      std::map<int, int>::const_iterator it = mRunIndexMap.find( mBadRunIds[iRun] );
+      // Runs without an index were reported when the lists were loaded
+      if ( it == mRunIndexMap.end() ) continue;
+      mBadRunMask[it->second] = true;
+    }
+    LOG_INFO << "Bad runs: " << mBadRunIds.size() << " in the list" << endm;
+  }
+  if ( mBadTowers.any() ) {
+    LOG_INFO << "Bad towers: " << mBadTowers.count() << endm;
+  }
+
+  if ( mSortInputByRun && mIsFromMaker ) {
+    LOG_WARN << "Ordering the input by run needs StPicoDstReader. It is ignored with StPicoDstMaker" << endm;
+  }
+  else if ( mSortInputByRun && !mAugmentFileName.IsNull() ) {
+    LOG_WARN << "Input ordered by run: the skim to augment must have been made in the same order" << endm;
+  }
+
   // Retrieve PicoDst
   if ( mIsFromMaker ) {
     // Check that StPicoDstMaker exists
     if (mPicoDstMaker) {
       // Retrieve pointer to the StPicoDst structure
+#if !defined(_VANILLA_ROOT_)
       mPicoDst = mPicoDstMaker->picoDst();
+#endif
     }
     else {
       LOG_ERROR << "No StPicoDstMaker has been found. Terminating." << endm;
@@ -107,11 +317,28 @@ Int_t StPicoEASkimmer::Init() {
   else {
     // Check that StPicoDstReader exists
     if ( mPicoDstReader ) {
+      // Open the input and read only the branches used by the skimmer
+      mPicoDstReader->setSortByRun(mSortInputByRun);
+      mPicoDstReader->Init();
+      if ( !mPicoDstReader->chain() ) {
+        LOG_ERROR << "StPicoDstReader has no input. Terminating." << endm;
+        return kStErr;
+      }
+      mPicoDstReader->SetStatus("*", 0);
+      mPicoDstReader->SetStatus("Event*", 1);
+      mPicoDstReader->SetStatus("Track*", 1);
+      mPicoDstReader->SetStatus("BTofPidTraits*", 1);
+      if ( mAugmentFileName.IsNull() ) {
+        mPicoDstReader->SetStatus("EmcTrigger*", 1);
+        mPicoDstReader->SetStatus("EmcPidTraits*", 1);
+        mPicoDstReader->SetStatus("BTowHit*", 1);
+      }
+
       // Retrieve pointer to the StPicoDst structure
       mPicoDst = mPicoDstReader->picoDst();
     }
     else {
-      LOG_ERROR << "No StPicoDstMaker has been found. Terminating." << endm;
+      LOG_ERROR << "No StPicoDstReader has been found. Terminating." << endm;
       return kStErr;
     }
   } // else
@@ -122,19 +349,47 @@ Int_t StPicoEASkimmer::Init() {
     return kStErr;
   }
 
+  // Split output: the first file is already a part
+  if ( mMaxOutputSize > 0 || mMaxEntriesPerFile > 0 ) {
+    if ( !mAugmentFileName.IsNull() ) {
+      LOG_WARN << "Output rollover is not supported for augmentation. It is switched off" << endm;
+      mMaxOutputSize = 0;
+      mMaxEntriesPerFile = 0;
+    }
+    else {
+      mOutFileStem = mOutFileName;
+      if ( mOutFileStem.EndsWith(".root") ) mOutFileStem.Resize( mOutFileStem.Length() - 5 );
+      mOutFilePart = 0;
+      mOutFileName = PartFileName(mOutFilePart);
+    }
+  }
+
   // Create output file
   if (!mOutFile) {
     mOutFile = new TFile(mOutFileName, "recreate");
+    WriteConfig(mOutFile);
   }
   else {
     LOG_WARN << "Output file: " << mOutFileName << " already exist!" << endm;
   }
 
-  // Create histograms
-  CreateHistograms();
+  if ( !mAugmentFileName.IsNull() ) {
+    // Only the friend tree is written
+    if ( InitAugment() != kStOk ) return kStErr;
+  }
+  else {
+    // Create histograms
+    CreateHistograms();
+
+    // Book TTree and branches (stream-only output without the main tree)
+    if ( mWriteMainTree ) CreateEATree();
+
+    // Book trigger stream trees
+    CreateStreams();
+  }
 
-  // Book TTree and branches
-  CreateEATree();
+  // Start the wall clock for the budget
+  mWallClock.Start();
 
   if (mDebug)
   {
@@ -152,10 +407,55 @@ Int_t StPicoEASkimmer::Finish() {
     LOG_INFO << "Finishing StPicoEASkimmer..." << endm;
   }
 
-  // Write histograms to the file and then close it
+  // Friend tree has to cover all skim entries
+  Bool_t isFriendMisaligned = false;
+  if ( mFriendTree ) {
+    LOG_INFO << "Augmentation: " << mAugmentEntry << " of " << mAugmentTree->GetEntries()
+             << " skim entries have been matched, " << mAugmentNMismatches
+             << " with a different track selection" << endm;
+    isFriendMisaligned = ( mAugmentEntry != mAugmentTree->GetEntries() );
+  }
+
+  if ( mFindV0 ) {
+    LOG_INFO << "V0 finder: " << mV0Finder.numberOfPairs() << " pairs, "
+             << mV0Finder.numberOfPreselectedPairs() << " passed the preselection, "
+             << mV0Finder.numberOfCandidates() << " candidates" << endm;
+  }
+
+  LOG_INFO << "Run-level state resolved " << mNRunChanges << " times" << endm;
+  if ( !mBadRunMask.empty() ) {
+    LOG_INFO << "Bad runs: " << mNBadRunEvents << " events rejected" << endm;
+  }
+  if ( mBadTowers.any() ) {
+    LOG_INFO << "Bad towers: " << mNBadTowerTracks << " track matches and "
+             << mNBadTowerHts << " HT triggers dropped" << endm;
+  }
+
+  if ( mVertexRefit ) {
+    LOG_INFO << "Vertex refit: " << mNVertexRefits << " events, "
+             << mNVertexRefitsNoCov << " without covariance matrices, "
+             << mNVertexRefitsFailed << " failed" << endm;
+  }
+
+  // Run index tables go next to the trees
+  WriteRunIndex();
+
+  // Write and close the stream files
+  for (unsigned int iStream=0; iStream<mStreams.size(); iStream++) {
+    StPicoEAStream &stream = mStreams[iStream];
+    LOG_INFO << "Stream " << stream.name << ": " << stream.nEvents << " events" << endm;
+    if (stream.file) {
+      LOG_INFO << "Writing file: " << stream.fileName << endm;
+      stream.file->Write(nullptr, TObject::kOverwrite);
+      stream.file->Close();
+    }
+  }
+
+  // Write histograms to the file and then close it. Objects already
+  // written at checkpoints are overwritten
   if (mOutFile) {
     LOG_INFO << "Writing file: " << mOutFileName << endm;
-    mOutFile->Write();
+    mOutFile->Write(nullptr, TObject::kOverwrite);
     mOutFile->Close();
     LOG_INFO << "\t[DONE]" << endm;
   }
@@ -163,6 +463,25 @@ Int_t StPicoEASkimmer::Finish() {
     LOG_WARN << "Output file does not exist. Nowhere to write!" << endm;
   }
 
+  if (mAugmentFile) {
+    mAugmentFile->Close();
+  }
+
+  // The input is marked as completed only when all of it has been read
+  // (not after maxEvents, an error or the wall-clock budget)
+  if ( !mCheckpointFileName.IsNull() ) {
+    WriteStateFile( mIsEndOfInput );
+  }
+
+  // A misaligned EAFriend must not be used or merged: remove it
+  if ( isFriendMisaligned ) {
+    LOG_ERROR << "EAFriend is not aligned with " << mAugmentFileName
+              << ": the input does not contain all skimmed events in the skim order."
+              << " Removing " << mOutFileName << endm;
+    gSystem->Unlink( mOutFileName.Data() );
+    return kStErr;
+  }
+
   if (mDebug) {
     LOG_INFO << "StPicoEASkimmer has been initialized" << endm;
   }
@@ -170,6 +489,110 @@ Int_t StPicoEASkimmer::Finish() {
   return kStOk;
 }
 
+//________________
+void StPicoEASkimmer::WriteCheckpoint() {
+
+  if (!mOutFile) return;
+
+  TDirectory *saveDir = gDirectory;
+
+  // Trees: AutoSave flushes the baskets and writes the tree header, so the
+  // file is readable up to this entry even if the job is killed later
+  if (mEATree) mEATree->AutoSave("SaveSelf");
+  if (mFriendTree) mFriendTree->AutoSave("SaveSelf");
+  for (unsigned int iStream=0; iStream<mStreams.size(); iStream++) {
+    if (mStreams[iStream].tree) mStreams[iStream].tree->AutoSave("SaveSelf");
+  }
+  WriteRunIndex();
+
+  // Histograms: overwrite the previous checkpoint
+  mOutFile->cd();
+  TIter next( mOutFile->GetList() );
+  TObject *obj = nullptr;
+  while ( (obj = next()) ) {
+    if ( obj->InheritsFrom( TH1::Class() ) ) {
+      obj->Write(nullptr, TObject::kOverwrite);
+    }
+  }
+  mOutFile->SaveSelf(kTRUE);
+  saveDir->cd();
+
+  WriteStateFile(false);
+
+  if (mDebug) {
+    LOG_INFO << "Checkpoint has been written after event " << mEventCounter << endm;
+  }
+}
+
+//________________
+void StPicoEASkimmer::WriteRunIndex() {
+
+  if ( mEATree ) {
+    mRunIndexTable.write(mOutFile, "RunIndex");
+  }
+  for (unsigned int iStream=0; iStream<mStreams.size(); iStream++) {
+    const StPicoEAStream &stream = mStreams[iStream];
+    if ( stream.file ) {
+      stream.runIndex.write(stream.file, "RunIndex");
+    }
+    else {
+      stream.runIndex.write(mOutFile, Form("RunIndex_%s", stream.name.Data()));
+    }
+  }
+}
+
+//________________
+TChain* StPicoEASkimmer::InputChain() const {
+  if ( mIsFromMaker ) {
+#if !defined(_VANILLA_ROOT_)
+    return ( mPicoDstMaker ) ? mPicoDstMaker->chain() : nullptr;
+#else
+    return nullptr;
+#endif
+  }
+  return ( mPicoDstReader ) ? mPicoDstReader->chain() : nullptr;
+}
+
+//________________
+void StPicoEASkimmer::WriteStateFile(Bool_t isComplete) {
+
+  // Last completed entry of the input
+  TChain *chain = InputChain();
+  TString fileName = "";
+  Long64_t localEntry = -1;
+  Long64_t globalEntry = -1;
+  if ( chain && chain->GetTree() && chain->GetTreeNumber() >= 0 ) {
+    TChainElement *element =
+      (TChainElement*)chain->GetListOfFiles()->At( chain->GetTreeNumber() );
+    if (element) fileName = element->GetTitle();
+    localEntry = chain->GetTree()->GetReadEntry();
+    globalEntry = chain->GetTreeOffset()[ chain->GetTreeNumber() ] + localEntry;
+  }
+
+  // Write to a temporary file first, so a crash never leaves a broken state file
+  TString tmpName = mCheckpointFileName + ".tmp";
+  std::ofstream stateStream( tmpName.Data() );
+  if ( !stateStream ) {
+    LOG_ERROR << "Cannot write state file " << tmpName << endm;
+    return;
+  }
+  stateStream << "# StPicoEASkimmer checkpoint" << std::endl;
+  stateStream << "output " << mOutFileName << std::endl;
+  stateStream << "file " << fileName << std::endl;
+  stateStream << "entry " << localEntry << std::endl;
+  stateStream << "globalEntry " << globalEntry << std::endl;
+  stateStream << "eventsProcessed " << mEventCounter << std::endl;
+  stateStream << "resumeCount " << mResumeCount << std::endl;
+  // File order of this attempt: a resumed attempt must read the same order
+  // (StPicoDstMaker does not order the files by run)
+  Bool_t isSortedByRun = ( !mIsFromMaker && mPicoDstReader && mPicoDstReader->sortByRun() );
+  stateStream << "sortByRun " << ( isSortedByRun ? 1 : 0 ) << std::endl;
+  stateStream << "inputHash " << StPicoDstReader::fileListHash(chain) << std::endl;
+  stateStream << "complete " << ( isComplete ? 1 : 0 ) << std::endl;
+  stateStream.close();
+  gSystem->Rename( tmpName.Data(), mCheckpointFileName.Data() );
+}
+
 //________________
 void StPicoEASkimmer::CreateHistograms() {
   if (mDebug) {
@@ -287,70 +710,963 @@ void StPicoEASkimmer::CreateHistograms() {
 void StPicoEASkimmer::CreateEATree()
 {
   mEATree = new TTree("EATree", "Event and tracks information");
+  BookEATreeBranches(mEATree);
+
+  if (mDebug) {
+    LOG_INFO << "TTree and branches have been created." << endm;
+  }
+}
 
+//________________
+void StPicoEASkimmer::BookEATreeBranches(TTree *tree)
+{
   // Event-level branches
-  mEATree->Branch("eventID", &mEventID, "eventID/I");
-  mEATree->Branch("runIndex", &mRunIndex, "runIndex/I");
-  mEATree->Branch("vtxR", &mVtxR, "vtxR/F");
-  mEATree->Branch("vtxZ", &mVtxZ, "vtxZ/F");
-  mEATree->Branch("vtxVpdZ", &mVtxVpdZ, "vtxVpdZ/F");
-  mEATree->Branch("vtxRanking", &mVtxRanking, "vtxRanking/F");
-  mEATree->Branch("vtxErrorXY", &mVtxErrorXY, "vtxErrorXY/F");
-  mEATree->Branch("vtxErrorZ", &mVtxErrorZ, "vtxErrorZ/F");
-  mEATree->Branch("refMult", &mRefMult, "refMult/I");
-  mEATree->Branch("gRefMult", &mGRefMult, "gRefMult/I");
-  mEATree->Branch("nBTofMatch", &mNBTofMatch, "nBTofMatch/I");
-  mEATree->Branch("nBEmcMatch", &mNBEmcMatch, "nBEmcMatch/I");
-  mEATree->Branch("BBCx", &mBBCx, "BBCx/F");
-  mEATree->Branch("ZDCx", &mZDCx, "ZDCx/F");
-  mEATree->Branch("nPrimaries", &mNPrimaries, "nPrimaries/I");
+  tree->Branch("eventID", &mEventID, "eventID/I");
+  tree->Branch("runId", &mRunId, "runId/I");
+  tree->Branch("runIndex", &mRunIndex, "runIndex/I");
+  tree->Branch("vtxR", &mVtxR, "vtxR/F");
+  tree->Branch("vtxZ", &mVtxZ, "vtxZ/F");
+  tree->Branch("vtxVpdZ", &mVtxVpdZ, "vtxVpdZ/F");
+  tree->Branch("vtxRanking", &mVtxRanking, "vtxRanking/F");
+  tree->Branch("vtxErrorXY", &mVtxErrorXY, "vtxErrorXY/F");
+  tree->Branch("vtxErrorZ", &mVtxErrorZ, "vtxErrorZ/F");
+  tree->Branch("refMult", &mRefMult, "refMult/I");
+  tree->Branch("gRefMult", &mGRefMult, "gRefMult/I");
+  tree->Branch("nBTofMatch", &mNBTofMatch, "nBTofMatch/I");
+  tree->Branch("nBEmcMatch", &mNBEmcMatch, "nBEmcMatch/I");
+  tree->Branch("BBCx", &mBBCx, "BBCx/F");
+  tree->Branch("ZDCx", &mZDCx, "ZDCx/F");
+  tree->Branch("nPrimaries", &mNPrimaries, "nPrimaries/I");
+
+  // Event-activity observables relative to the leading track
+  tree->Branch("ea_leadIndex", &mEALeadIndex, "ea_leadIndex/I");
+  tree->Branch("ea_leadPt", &mEALeadPt, "ea_leadPt/F");
+  tree->Branch("ea_leadEta", &mEALeadEta, "ea_leadEta/F");
+  tree->Branch("ea_leadPhi", &mEALeadPhi, "ea_leadPhi/F");
+  tree->Branch("ea_nToward", &mEANToward, "ea_nToward/I");
+  tree->Branch("ea_nAway", &mEANAway, "ea_nAway/I");
+  tree->Branch("ea_nTrans", &mEANTrans, "ea_nTrans/I");
+  tree->Branch("ea_nTransMax", &mEANTransMax, "ea_nTransMax/I");
+  tree->Branch("ea_nTransMin", &mEANTransMin, "ea_nTransMin/I");
+  tree->Branch("ea_sumPtToward", &mEASumPtToward, "ea_sumPtToward/F");
+  tree->Branch("ea_sumPtAway", &mEASumPtAway, "ea_sumPtAway/F");
+  tree->Branch("ea_sumPtTrans", &mEASumPtTrans, "ea_sumPtTrans/F");
+  tree->Branch("ea_sumPtTransMax", &mEASumPtTransMax, "ea_sumPtTransMax/F");
+  tree->Branch("ea_sumPtTransMin", &mEASumPtTransMin, "ea_sumPtTransMin/F");
 
   // BBC ADC signals (24 tiles each, using fixed-size arrays.
-  mEATree->Branch("bbcAdcEast", mBbcAdcEast, "bbcAdcEast[24]/S");
-  mEATree->Branch("bbcAdcWest", mBbcAdcWest, "bbcAdcWest[24]/S");
+  tree->Branch("bbcAdcEast", mBbcAdcEast, "bbcAdcEast[24]/S");
+  tree->Branch("bbcAdcWest", mBbcAdcWest, "bbcAdcWest[24]/S");
 
   // Event trigger IDs (vector of unsigned ints)
-  mEATree->Branch("event_triggerIds", &mEventTriggerIds);
+  tree->Branch("event_triggerIds", &mEventTriggerIds);
 
   // HT trigger details: flag, softId (tower id), adc
-  mEATree->Branch("ht_flag", &mHtFlag);
-  mEATree->Branch("ht_id", &mHtId);
-  mEATree->Branch("ht_adc", &mHtAdc);
+  tree->Branch("ht_flag", &mHtFlag);
+  tree->Branch("ht_id", &mHtId);
+  tree->Branch("ht_adc", &mHtAdc);
 
   // Track-level branches (std::vector for each variable)
-  mEATree->Branch("track_pt", &mTrackPt);
-  mEATree->Branch("track_eta", &mTrackEta);
-  mEATree->Branch("track_phi", &mTrackPhi);
-  mEATree->Branch("track_charge", &mTrackCharge);
-  mEATree->Branch("track_nHitsFit", &mTrackNHitsFit);
-  mEATree->Branch("track_nHitsDedx", &mTrackNHitsDedx);
-  mEATree->Branch("track_nHitsRatio", &mTrackNHitsRatio);
-  mEATree->Branch("track_chi2", &mTrackChi2);
-  mEATree->Branch("track_dcaXY", &mTrackDCAxy);
-  mEATree->Branch("track_dcaZ", &mTrackDCAz);
-  mEATree->Branch("track_dcaS", &mTrackDCAs);
-  mEATree->Branch("track_nSigmaPi", &mTrackNSigmaPi);
-  mEATree->Branch("track_nSigmaK", &mTrackNSigmaK);
-  mEATree->Branch("track_nSigmaP", &mTrackNSigmaP);
-  mEATree->Branch("track_nSigmaE", &mTrackNSigmaE);
-  mEATree->Branch("track_isTofTrack", &mTrackIsTofTrack);
-  mEATree->Branch("track_btofBeta", &mTrackBTofBeta);
-  mEATree->Branch("track_mass2", &mTrackMass2);
-  mEATree->Branch("track_isBemcTrack", &mTrackIsBemcTrack);
-  mEATree->Branch("track_bemcE", &mTrackBemcE);
-  mEATree->Branch("track_bemcZDist", &mTrackBemcZDist);
-  mEATree->Branch("track_bemcPhiDist", &mTrackBemcPhiDist);
-  mEATree->Branch("track_btowId", &mTrackBtowId);
-  mEATree->Branch("track_btowE", &mTrackBtowE);
-  mEATree->Branch("track_btowPhiDist", &mTrackBtowPhiDist);
-  mEATree->Branch("track_btowEtaDist", &mTrackBtowEtaDist);
+  tree->Branch("track_pt", &mTrackPt);
+  tree->Branch("track_eta", &mTrackEta);
+  tree->Branch("track_phi", &mTrackPhi);
+  tree->Branch("track_charge", &mTrackCharge);
+  tree->Branch("track_nHitsFit", &mTrackNHitsFit);
+  tree->Branch("track_nHitsDedx", &mTrackNHitsDedx);
+  tree->Branch("track_nHitsRatio", &mTrackNHitsRatio);
+  tree->Branch("track_chi2", &mTrackChi2);
+  tree->Branch("track_dcaXY", &mTrackDCAxy);
+  tree->Branch("track_dcaZ", &mTrackDCAz);
+  tree->Branch("track_dcaS", &mTrackDCAs);
+  tree->Branch("track_nSigmaPi", &mTrackNSigmaPi);
+  tree->Branch("track_nSigmaK", &mTrackNSigmaK);
+  tree->Branch("track_nSigmaP", &mTrackNSigmaP);
+  tree->Branch("track_nSigmaE", &mTrackNSigmaE);
+  tree->Branch("track_isTofTrack", &mTrackIsTofTrack);
+  tree->Branch("track_btofBeta", &mTrackBTofBeta);
+  tree->Branch("track_mass2", &mTrackMass2);
+  tree->Branch("track_isBemcTrack", &mTrackIsBemcTrack);
+  tree->Branch("track_bemcE", &mTrackBemcE);
+  tree->Branch("track_bemcZDist", &mTrackBemcZDist);
+  tree->Branch("track_bemcPhiDist", &mTrackBemcPhiDist);
+  tree->Branch("track_btowId", &mTrackBtowId);
+  tree->Branch("track_btowE", &mTrackBtowE);
+  tree->Branch("track_btowPhiDist", &mTrackBtowPhiDist);
+  tree->Branch("track_btowEtaDist", &mTrackBtowEtaDist);
+  tree->Branch("track_btowE3x3", &mTrackBtowE3x3);
+  tree->Branch("track_btowEMaxNb", &mTrackBtowEMaxNb);
+  tree->Branch("track_htMatch", &mTrackHtMatch);
+
+  // V0 candidates
+  if ( mFindV0 ) {
+    tree->Branch("v0_massK0s", &mV0MassK0s);
+    tree->Branch("v0_massLambda", &mV0MassLambda);
+    tree->Branch("v0_massAntiLambda", &mV0MassAntiLambda);
+    tree->Branch("v0_pt", &mV0Pt);
+    tree->Branch("v0_eta", &mV0Eta);
+    tree->Branch("v0_phi", &mV0Phi);
+    tree->Branch("v0_decayLength", &mV0DecayLength);
+    tree->Branch("v0_dcaDaughters", &mV0DcaDaughters);
+    tree->Branch("v0_dcaToPV", &mV0DcaToPV);
+    tree->Branch("v0_cosPointing", &mV0CosPointing);
+    tree->Branch("v0_posDca", &mV0PosDca);
+    tree->Branch("v0_negDca", &mV0NegDca);
+    tree->Branch("v0_posNSigmaPi", &mV0PosNSigmaPi);
+    tree->Branch("v0_posNSigmaP", &mV0PosNSigmaP);
+    tree->Branch("v0_negNSigmaPi", &mV0NegNSigmaPi);
+    tree->Branch("v0_negNSigmaP", &mV0NegNSigmaP);
+  }
 
-  if (mDebug) {
-    LOG_INFO << "TTree and branches have been created." << endm;
+  // Primary vertex refit and unbiased track DCAs
+  if ( mVertexRefit ) {
+    tree->Branch("vtxRefitX", &mVtxRefitX, "vtxRefitX/F");
+    tree->Branch("vtxRefitY", &mVtxRefitY, "vtxRefitY/F");
+    tree->Branch("vtxRefitZ", &mVtxRefitZ, "vtxRefitZ/F");
+    tree->Branch("vtxRefitErrorX", &mVtxRefitErrorX, "vtxRefitErrorX/F");
+    tree->Branch("vtxRefitErrorY", &mVtxRefitErrorY, "vtxRefitErrorY/F");
+    tree->Branch("vtxRefitErrorZ", &mVtxRefitErrorZ, "vtxRefitErrorZ/F");
+    tree->Branch("vtxRefitChi2Ndf", &mVtxRefitChi2Ndf, "vtxRefitChi2Ndf/F");
+    tree->Branch("vtxRefitSumW", &mVtxRefitSumW, "vtxRefitSumW/F");
+    tree->Branch("track_dcaXYUnbiased", &mTrackDCAxyUnbiased);
+    tree->Branch("track_dcaZUnbiased", &mTrackDCAzUnbiased);
+    tree->Branch("track_dcaSig", &mTrackDCASig);
+  }
+}
+
+//________________
+void StPicoEASkimmer::FillBtowEnergies()
+{
+  std::fill_n(mBtowEnergy, StPicoEABtowGeometry::kNTowers, 0.f);
+
+  // picoDst keeps all towers in the softId order
+  unsigned int nBTowHits = mPicoDst->numberOfBTowHits();
+  if (nBTowHits > (unsigned int)StPicoEABtowGeometry::kNTowers) {
+    nBTowHits = StPicoEABtowGeometry::kNTowers;
+  }
+  for (unsigned int iHit=0; iHit<nBTowHits; iHit++) {
+    StPicoBTowHit *btowHit = mPicoDst->btowHit(iHit);
+    if (btowHit && !mBadTowers.test(iHit)) mBtowEnergy[iHit] = btowHit->energy();
+  }
+}
+
+//________________
+void StPicoEASkimmer::BtowClusterEnergies(Int_t towerIndex, Float_t &e3x3, Float_t &eMaxNeighbour) const
+{
+  const Int_t *neighbours = StPicoEABtowGeometry::neighbours(towerIndex);
+  e3x3 = mBtowEnergy[towerIndex];
+  eMaxNeighbour = 0.f;
+  for (Int_t iNb=0; iNb<StPicoEABtowGeometry::kNNeighbours; iNb++) {
+    if (neighbours[iNb] < 0) continue;
+    Float_t energy = mBtowEnergy[ neighbours[iNb] ];
+    e3x3 += energy;
+    if (energy > eMaxNeighbour) eMaxNeighbour = energy;
+  }
+}
+
+//________________
+void StPicoEASkimmer::ComputeEAObservables()
+{
+  // Leading track among the stored tracks
+  mEALeadIndex = -1;
+  Float_t leadPt = mEALeadPtMin;
+  for (unsigned int iTrk=0; iTrk<mTrackPt.size(); iTrk++) {
+    if ( mTrackPt[iTrk] >= leadPt ) {
+      leadPt = mTrackPt[iTrk];
+      mEALeadIndex = iTrk;
+    }
+  }
+
+  mEANToward = 0; mEANAway = 0; mEANTrans = 0;
+  mEANTransMax = 0; mEANTransMin = 0;
+  mEASumPtToward = 0.f; mEASumPtAway = 0.f; mEASumPtTrans = 0.f;
+  mEASumPtTransMax = 0.f; mEASumPtTransMin = 0.f;
+  if ( mEALeadIndex < 0 ) {
+    mEALeadPt = -9999.0f;
+    mEALeadEta = -9999.0f;
+    mEALeadPhi = -9999.0f;
+    return;
+  }
+  mEALeadPt = mTrackPt[mEALeadIndex];
+  mEALeadEta = mTrackEta[mEALeadIndex];
+  mEALeadPhi = mTrackPhi[mEALeadIndex];
+
+  // Regions: |dphi| < pi/3 toward, > 2pi/3 away, transverse in between
+  // (sides with dphi > 0 and dphi < 0 counted separately)
+  Int_t nTransSide[2] = {0, 0};
+  Float_t sumPtTransSide[2] = {0.f, 0.f};
+  for (unsigned int iTrk=0; iTrk<mTrackPt.size(); iTrk++) {
+    if ( (Int_t)iTrk == mEALeadIndex ) continue;
+    Float_t pt = mTrackPt[iTrk];
+    if ( pt < mEAPt[0] || pt > mEAPt[1] ) continue;
+    Float_t dPhi = TVector2::Phi_mpi_pi( mTrackPhi[iTrk] - mEALeadPhi );
+    Float_t absDPhi = TMath::Abs(dPhi);
+    if ( absDPhi < TMath::Pi() / 3. ) {
+      mEANToward++;
+      mEASumPtToward += pt;
+    }
+    else if ( absDPhi > 2. * TMath::Pi() / 3. ) {
+      mEANAway++;
+      mEASumPtAway += pt;
+    }
+    else {
+      Int_t iSide = ( dPhi > 0 ) ? 0 : 1;
+      nTransSide[iSide]++;
+      sumPtTransSide[iSide] += pt;
+    }
+  }
+  mEANTrans = nTransSide[0] + nTransSide[1];
+  mEANTransMax = TMath::Max(nTransSide[0], nTransSide[1]);
+  mEANTransMin = TMath::Min(nTransSide[0], nTransSide[1]);
+  mEASumPtTrans = sumPtTransSide[0] + sumPtTransSide[1];
+  mEASumPtTransMax = TMath::Max(sumPtTransSide[0], sumPtTransSide[1]);
+  mEASumPtTransMin = TMath::Min(sumPtTransSide[0], sumPtTransSide[1]);
+}
+
+//________________
+void StPicoEASkimmer::FillV0Candidates(StPicoEvent *event)
+{
+  mV0MassK0s.clear();
+  mV0MassLambda.clear();
+  mV0MassAntiLambda.clear();
+  mV0Pt.clear();
+  mV0Eta.clear();
+  mV0Phi.clear();
+  mV0DecayLength.clear();
+  mV0DcaDaughters.clear();
+  mV0DcaToPV.clear();
+  mV0CosPointing.clear();
+  mV0PosDca.clear();
+  mV0NegDca.clear();
+  mV0PosNSigmaPi.clear();
+  mV0PosNSigmaP.clear();
+  mV0NegNSigmaPi.clear();
+  mV0NegNSigmaP.clear();
+
+  mV0Finder.find(mPicoDst, event->primaryVertex(), event->bField());
+
+  const std::vector<StPicoEAV0Candidate> &candidates = mV0Finder.candidates();
+  for (unsigned int iV0=0; iV0<candidates.size(); iV0++) {
+    const StPicoEAV0Candidate &v0 = candidates[iV0];
+    StPicoTrack *posTrack = mPicoDst->track(v0.posIndex);
+    StPicoTrack *negTrack = mPicoDst->track(v0.negIndex);
+    mV0MassK0s.push_back(v0.massK0s);
+    mV0MassLambda.push_back(v0.massLambda);
+    mV0MassAntiLambda.push_back(v0.massAntiLambda);
+    mV0Pt.push_back(v0.pt);
+    mV0Eta.push_back(v0.eta);
+    mV0Phi.push_back(v0.phi);
+    mV0DecayLength.push_back(v0.decayLength);
+    mV0DcaDaughters.push_back(v0.dcaDaughters);
+    mV0DcaToPV.push_back(v0.dcaToPV);
+    mV0CosPointing.push_back(v0.cosPointing);
+    mV0PosDca.push_back(v0.posDca);
+    mV0NegDca.push_back(v0.negDca);
+    mV0PosNSigmaPi.push_back(posTrack->nSigmaPion());
+    mV0PosNSigmaP.push_back(posTrack->nSigmaProton());
+    mV0NegNSigmaPi.push_back(negTrack->nSigmaPion());
+    mV0NegNSigmaP.push_back(negTrack->nSigmaProton());
+  }
+}
+
+//________________
+void StPicoEASkimmer::RefitVertex(StPicoEvent *event)
+{
+  mIsVertexRefitted = false;
+  mVtxRefitX = mVtxRefitY = mVtxRefitZ = -9999.f;
+  mVtxRefitErrorX = mVtxRefitErrorY = mVtxRefitErrorZ = -9999.f;
+  mVtxRefitChi2Ndf = -9999.f;
+  mVtxRefitSumW = 0.f;
+  mNVertexRefits++;
+
+  // Covariance matrices are stored for all tracks or not at all
+  if ( mTrackCovArrays.fill() != (Int_t)mPicoDst->numberOfTracks() ) {
+    if ( mNVertexRefitsNoCov == 0 ) {
+      LOG_WARN << "No track covariance matrices in event " << event->eventId()
+               << " of run " << event->runId()
+               << ": the vertex is not refitted" << endm;
+    }
+    mNVertexRefitsNoCov++;
+    return;
+  }
+
+  if ( !mVertexFitter.fit(mPicoDst, mTrackCovArrays, event->primaryVertex()) ) {
+    mNVertexRefitsFailed++;
+    return;
+  }
+
+  mIsVertexRefitted = true;
+  const TVector3 &vtx = mVertexFitter.vertex();
+  TVector3 vtxError = mVertexFitter.vertexError();
+  mVtxRefitX = vtx.X();
+  mVtxRefitY = vtx.Y();
+  mVtxRefitZ = vtx.Z();
+  mVtxRefitErrorX = vtxError.X();
+  mVtxRefitErrorY = vtxError.Y();
+  mVtxRefitErrorZ = vtxError.Z();
+  mVtxRefitChi2Ndf = ( mVertexFitter.ndf() > 0 ) ?
+    mVertexFitter.chi2() / mVertexFitter.ndf() : -9999.f;
+  mVtxRefitSumW = mVertexFitter.sumOfWeights();
+}
+
+//________________
+Short_t StPicoEASkimmer::HtMatchMask(Int_t towerIndex) const
+{
+  Short_t mask = 0;
+  for (Int_t iHt=0; iHt<4; iHt++) {
+    if ( mHtTowers[iHt].none() ) continue;
+    if ( mHtTowers[iHt].test(towerIndex) ) mask |= (1 << iHt);
+    if ( !mHtMatchNeighbours ) continue;
+    Bool_t isClusterFired = mHtTowers[iHt].test(towerIndex);
+    const Int_t *neighbours = StPicoEABtowGeometry::neighbours(towerIndex);
+    for (Int_t iNb=0; iNb<StPicoEABtowGeometry::kNNeighbours && !isClusterFired; iNb++) {
+      if ( neighbours[iNb] >= 0 && mHtTowers[iHt].test( neighbours[iNb] ) ) isClusterFired = true;
+    }
+    if ( isClusterFired ) mask |= (1 << (4 + iHt));
+  }
+  return mask;
+}
+
+//________________
+Int_t StPicoEASkimmer::InitAugment()
+{
+  mAugmentFile = TFile::Open(mAugmentFileName.Data());
+  if ( !mAugmentFile || mAugmentFile->IsZombie() ) {
+    LOG_ERROR << "Cannot open skim file to augment: " << mAugmentFileName << endm;
+    return kStErr;
+  }
+  mAugmentTree = (TTree*)mAugmentFile->Get(mAugmentTreeName.Data());
+  if ( !mAugmentTree || !mAugmentTree->GetBranch("eventID") || !mAugmentTree->GetBranch("track_pt") ) {
+    LOG_ERROR << "No " << mAugmentTreeName << " with eventID and track_pt in "
+              << mAugmentFileName << endm;
+    return kStErr;
+  }
+
+  // Read only the alignment columns
+  mAugmentTree->SetBranchStatus("*", 0);
+  mAugmentTree->SetBranchStatus("eventID", 1);
+  mAugmentTree->SetBranchAddress("eventID", &mAugmentEventID);
+  mAugmentHasRunId = ( mAugmentTree->GetBranch("runId") != nullptr );
+  if ( mAugmentHasRunId ) {
+    mAugmentTree->SetBranchStatus("runId", 1);
+    mAugmentTree->SetBranchAddress("runId", &mAugmentRunId);
+  }
+  else {
+    LOG_WARN << mAugmentFileName << " has no runId branch: events are aligned by eventID only" << endm;
+  }
+  mAugmentTree->SetBranchStatus("track_pt", 1);
+  mAugmentTree->SetBranchAddress("track_pt", &mAugmentTrackPt);
+  mAugmentEntry = 0;
+  mAugmentNMismatches = 0;
+
+  mOutFile->cd();
+  mFriendTree = new TTree("EAFriend", Form("Additional track information for %s",
+                                           mAugmentTreeName.Data()));
+  mFriendTree->Branch("eventID", &mEventID, "eventID/I");
+  mFriendTree->Branch("runId", &mRunId, "runId/I");
+  mFriendTree->Branch("track_dNdx", &mTrackDNdx);
+  mFriendTree->Branch("track_dNdxError", &mTrackDNdxError);
+  mFriendTree->Branch("track_topoMap0", &mTrackTopoMap0);
+  mFriendTree->Branch("track_topoMap1", &mTrackTopoMap1);
+  mFriendTree->Branch("track_btofYLocal", &mTrackBTofYLocal);
+  mFriendTree->Branch("track_btofZLocal", &mTrackBTofZLocal);
+
+  LOG_INFO << "Augmenting " << mAugmentTree->GetEntries() << " entries of "
+           << mAugmentTreeName << " in " << mAugmentFileName << endm;
+  return kStOk;
+}
+
+//________________
+Int_t StPicoEASkimmer::MakeAugmentEvent()
+{
+  mEventCounter++;
+
+  // All skim entries have been matched: nothing else to read
+  if ( mAugmentEntry >= mAugmentTree->GetEntries() ) {
+    mIsEndOfInput = true;
+    return kStEOF;
+  }
+
+  StPicoEvent *theEvent = mPicoDst->event();
+  if ( !theEvent ) return kStOk;
+
+  // Skim entries follow the order of the input: events that are not the
+  // next skim entry did not pass the skim
+  mAugmentTree->GetEntry(mAugmentEntry);
+  if ( mAugmentEventID != theEvent->eventId() ) return kStOk;
+  if ( mAugmentHasRunId && mAugmentRunId != theEvent->runId() ) return kStOk;
+
+  mEventID = theEvent->eventId();
+  mRunId = theEvent->runId();
+  mTrackDNdx.clear();
+  mTrackDNdxError.clear();
+  mTrackTopoMap0.clear();
+  mTrackTopoMap1.clear();
+  mTrackBTofYLocal.clear();
+  mTrackBTofZLocal.clear();
+
+  // Same track selection as for EATree
+  UInt_t nTracksForTree = 0;
+  Bool_t isSameSelection = true;
+  const unsigned int nTracks = mPicoDst->numberOfTracks();
+  for (unsigned int iTrk=0; iTrk<nTracks; iTrk++) {
+    StPicoTrack *theTrack = (StPicoTrack*)mPicoDst->track(iTrk);
+    if (!theTrack) continue;
+    if (!TrackCutForTree(theTrack)) continue;
+
+    if ( nTracksForTree >= mAugmentTrackPt->size() ||
+         mAugmentTrackPt->at(nTracksForTree) != theTrack->pPt() ) {
+      isSameSelection = false;
+    }
+    nTracksForTree++;
+
+    mTrackDNdx.push_back(theTrack->dNdx());
+    mTrackDNdxError.push_back(theTrack->dNdxError());
+    mTrackTopoMap0.push_back(theTrack->topologyMap(0));
+    mTrackTopoMap1.push_back(theTrack->topologyMap(1));
+
+    StPicoBTofPidTraits *tofPidTrait = nullptr;
+    if (theTrack->isTofTrack()) {
+      tofPidTrait = (StPicoBTofPidTraits*)mPicoDst->btofPidTraits(theTrack->bTofPidTraitsIndex());
+    }
+    if (tofPidTrait) {
+      mTrackBTofYLocal.push_back(tofPidTrait->btofYLocal());
+      mTrackBTofZLocal.push_back(tofPidTrait->btofZLocal());
+    } else {
+      mTrackBTofYLocal.push_back(-9999.0f);
+      mTrackBTofZLocal.push_back(-9999.0f);
+    }
+  }
+
+  // Keep the per-track alignment with the skim even if the cuts differ
+  if ( !isSameSelection || nTracksForTree != mAugmentTrackPt->size() ) {
+    if ( mAugmentNMismatches == 0 ) {
+      LOG_ERROR << "Track selection differs from the skim in event " << mEventID
+                << " of run " << mRunId << ": check the tree-level track cuts" << endm;
+    }
+    mAugmentNMismatches++;
+    const size_t nSkimTracks = mAugmentTrackPt->size();
+    mTrackDNdx.assign(nSkimTracks, -9999.0f);
+    mTrackDNdxError.assign(nSkimTracks, -9999.0f);
+    mTrackTopoMap0.assign(nSkimTracks, 0);
+    mTrackTopoMap1.assign(nSkimTracks, 0);
+    mTrackBTofYLocal.assign(nSkimTracks, -9999.0f);
+    mTrackBTofZLocal.assign(nSkimTracks, -9999.0f);
+  }
+
+  mFriendTree->Fill();
+  mAugmentEntry++;
+  return kStOk;
+}
+
+//________________
+void StPicoEASkimmer::CreateStreams()
+{
+  for (unsigned int iStream=0; iStream<mStreams.size(); iStream++) {
+    StPicoEAStream &stream = mStreams[iStream];
+
+    // Event cuts that were not overridden follow the main tree cuts
+    if ( !(stream.cutOverrides & kStreamVtxZ) ) {
+      stream.cutVtxZ[0] = mTreeCutVtxZ[0]; stream.cutVtxZ[1] = mTreeCutVtxZ[1];
+    }
+    if ( !(stream.cutOverrides & kStreamVtxR) ) {
+      stream.cutVtxR[0] = mTreeCutVtxR[0]; stream.cutVtxR[1] = mTreeCutVtxR[1];
+    }
+    if ( !(stream.cutOverrides & kStreamDeltaVz) ) {
+      stream.cutDeltaVz[0] = mTreeCutDeltaVz[0]; stream.cutDeltaVz[1] = mTreeCutDeltaVz[1];
+    }
+    if ( !(stream.cutOverrides & kStreamVtxVpdZ) ) {
+      stream.cutVtxVpdZ[0] = mTreeCutVtxVpdZ[0]; stream.cutVtxVpdZ[1] = mTreeCutVtxVpdZ[1];
+    }
+    if ( !(stream.cutOverrides & kStreamNPrimariesMin) ) {
+      stream.cutNPrimariesMin = mTreeCutNPrimariesMin;
+    }
+
+    if ( stream.triggerIds.empty() ) {
+      LOG_WARN << "Stream " << stream.name << " has no trigger IDs: all events "
+               << "passing the stream cuts will be written" << endm;
+    }
+    // Events with triggers outside of the global list never reach the router
+    for (unsigned int iTrg=0; iTrg<stream.triggerIds.size(); iTrg++) {
+      if ( !mTriggerId.empty() &&
+           !std::binary_search(mTriggerId.begin(), mTriggerId.end(), stream.triggerIds[iTrg]) ) {
+        LOG_WARN << "Trigger " << stream.triggerIds[iTrg] << " of stream " << stream.name
+                 << " is not in the global trigger list and will never be selected" << endm;
+      }
+    }
+
+    CreateStreamTree(stream);
+
+    if (mDebug) {
+      LOG_INFO << "Stream " << stream.name << " has been created" << endm;
+    }
+  }
+
+  // Histograms and the main tree stay in the main output file
+  if (mOutFile) mOutFile->cd();
+}
+
+//________________
+void StPicoEASkimmer::CreateStreamTree(StPicoEAStream &stream)
+{
+  if ( stream.fileName.IsNull() ) {
+    mOutFile->cd();
+    stream.tree = new TTree( Form("EATree_%s", stream.name.Data()),
+                             Form("Event and tracks information, %s stream", stream.name.Data()) );
   }
+  else {
+    if (!stream.file) {
+      stream.file = new TFile(stream.fileName.Data(), "recreate");
+      WriteConfig(stream.file);
+    }
+    stream.file->cd();
+    stream.tree = new TTree("EATree",
+                            Form("Event and tracks information, %s stream", stream.name.Data()) );
+  }
+  BookEATreeBranches(stream.tree);
+}
+
+//________________
+TString StPicoEASkimmer::PartFileName(Int_t part) const
+{
+  return TString::Format("%s_part%03d.root", mOutFileStem.Data(), part);
+}
+
+//________________
+Bool_t StPicoEASkimmer::IsRolloverNeeded()
+{
+  if ( !mOutFile || ( mMaxOutputSize <= 0 && mMaxEntriesPerFile <= 0 ) ) return false;
+
+  // Entries of the largest tree in the output file
+  Long64_t nEntries = ( mEATree ) ? mEATree->GetEntries() : 0;
+  for (unsigned int iStream=0; iStream<mStreams.size(); iStream++) {
+    if ( mStreams[iStream].file || !mStreams[iStream].tree ) continue;
+    nEntries = std::max( nEntries, mStreams[iStream].tree->GetEntries() );
+  }
+  if ( nEntries == 0 ) return false;
+  if ( mMaxEntriesPerFile > 0 && nEntries >= mMaxEntriesPerFile ) return true;
+
+  // Compressed bytes already on disk (baskets are written when they are
+  // full, so the size is underestimated by at most the open baskets)
+  return ( mMaxOutputSize > 0 && mOutFile->GetEND() >= mMaxOutputSize );
+}
+
+//________________
+void StPicoEASkimmer::RolloverOutputFile()
+{
+  // Close the current part: run index, trees and histograms
+  WriteRunIndex();
+  mOutFile->cd();
+  mOutFile->Write(nullptr, TObject::kOverwrite);
+  LOG_INFO << "Output part " << mOutFileName << " has been written" << endm;
+
+  // Histograms move to the next part and start from zero there
+  std::vector<TH1*> histograms;
+  TIter next( mOutFile->GetList() );
+  TObject *obj = nullptr;
+  while ( (obj = next()) ) {
+    if ( obj->InheritsFrom( TH1::Class() ) ) histograms.push_back( (TH1*)obj );
+  }
+
+  mOutFilePart++;
+  mOutFileName = PartFileName(mOutFilePart);
+  TFile *newFile = new TFile(mOutFileName, "recreate");
+  WriteConfig(newFile);
+  for (unsigned int iHist=0; iHist<histograms.size(); iHist++) {
+    histograms[iHist]->Reset();
+    histograms[iHist]->SetDirectory(newFile);
+  }
+
+  // Trees of the old part are deleted together with the file
+  mOutFile->Close();
+  delete mOutFile;
+  mOutFile = newFile;
+  mOutFile->cd();
+
+  mRunIndexTable.clear();
+  if ( mEATree ) CreateEATree();
+  for (unsigned int iStream=0; iStream<mStreams.size(); iStream++) {
+    StPicoEAStream &stream = mStreams[iStream];
+    if ( stream.file ) continue;
+    stream.runIndex.clear();
+    CreateStreamTree(stream);
+  }
+}
+
+//________________
+StPicoEAStream* StPicoEASkimmer::FindStream(const char* name)
+{
+  for (unsigned int iStream=0; iStream<mStreams.size(); iStream++) {
+    if ( mStreams[iStream].name == name ) return &mStreams[iStream];
+  }
+  LOG_ERROR << "Stream " << name << " does not exist. Call addStream first." << endm;
+  return nullptr;
+}
+
+//________________
+void StPicoEASkimmer::addStream(const char* name, const char* fileName)
+{
+  for (unsigned int iStream=0; iStream<mStreams.size(); iStream++) {
+    if ( mStreams[iStream].name == name ) {
+      LOG_WARN << "Stream " << name << " already exists" << endm;
+      return;
+    }
+  }
+  StPicoEAStream stream;
+  stream.name = name;
+  stream.fileName = fileName;
+  stream.file = nullptr;
+  stream.tree = nullptr;
+  stream.cutVtxZ[0] = mTreeCutVtxZ[0]; stream.cutVtxZ[1] = mTreeCutVtxZ[1];
+  stream.cutVtxR[0] = mTreeCutVtxR[0]; stream.cutVtxR[1] = mTreeCutVtxR[1];
+  stream.cutDeltaVz[0] = mTreeCutDeltaVz[0]; stream.cutDeltaVz[1] = mTreeCutDeltaVz[1];
+  stream.cutVtxVpdZ[0] = mTreeCutVtxVpdZ[0]; stream.cutVtxVpdZ[1] = mTreeCutVtxVpdZ[1];
+  stream.cutNPrimariesMin = mTreeCutNPrimariesMin;
+  stream.cutOverrides = 0;
+  stream.isAccepted = false;
+  stream.nEvents = 0;
+  mStreams.push_back(stream);
+}
+
+//________________
+void StPicoEASkimmer::addStreamTriggerId(const char* name, const unsigned int& id)
+{
+  StPicoEAStream *stream = FindStream(name);
+  if ( !stream ) return;
+  if ( std::find(stream->triggerIds.begin(), stream->triggerIds.end(), id) == stream->triggerIds.end() ) {
+    stream->triggerIds.push_back(id);
+    std::sort(stream->triggerIds.begin(), stream->triggerIds.end());
+  }
+}
+
+//________________
+void StPicoEASkimmer::setStreamVtxZ(const char* name, const float& lo, const float& hi)
+{
+  StPicoEAStream *stream = FindStream(name);
+  if ( !stream ) return;
+  stream->cutVtxZ[0] = lo; stream->cutVtxZ[1] = hi;
+  stream->cutOverrides |= kStreamVtxZ;
+}
+
+//________________
+void StPicoEASkimmer::setStreamVtxR(const char* name, const float& lo, const float& hi)
+{
+  StPicoEAStream *stream = FindStream(name);
+  if ( !stream ) return;
+  stream->cutVtxR[0] = lo; stream->cutVtxR[1] = hi;
+  stream->cutOverrides |= kStreamVtxR;
+}
+
+//________________
+void StPicoEASkimmer::setStreamDeltaVz(const char* name, const float& lo, const float& hi)
+{
+  StPicoEAStream *stream = FindStream(name);
+  if ( !stream ) return;
+  stream->cutDeltaVz[0] = lo; stream->cutDeltaVz[1] = hi;
+  stream->cutOverrides |= kStreamDeltaVz;
+}
+
+//________________
+void StPicoEASkimmer::setStreamVtxVpdZ(const char* name, const float& lo, const float& hi)
+{
+  StPicoEAStream *stream = FindStream(name);
+  if ( !stream ) return;
+  stream->cutVtxVpdZ[0] = lo; stream->cutVtxVpdZ[1] = hi;
+  stream->cutOverrides |= kStreamVtxVpdZ;
+}
+
+//________________
+void StPicoEASkimmer::setStreamNPrimariesMin(const char* name, const int& min)
+{
+  StPicoEAStream *stream = FindStream(name);
+  if ( !stream ) return;
+  stream->cutNPrimariesMin = min;
+  stream->cutOverrides |= kStreamNPrimariesMin;
+}
+
+//________________
+Bool_t StPicoEASkimmer::ReadConfigFile()
+{
+  std::ifstream configStream( mConfigFileName.Data() );
+  if ( !configStream ) {
+    LOG_ERROR << "Cannot open configuration file " << mConfigFileName << endm;
+    return false;
+  }
+  std::stringstream text;
+  text << configStream.rdbuf();
+  LOG_INFO << "Reading configuration from " << mConfigFileName << endm;
+  return applyConfig( text.str().c_str(), mConfigFileName.Data() );
+}
+
+//________________
+Bool_t StPicoEASkimmer::applyConfig(const char* text, const char* source)
+{
+  std::istringstream textStream(text);
+  std::string line;
+  Int_t lineNumber = 0;
+  while ( std::getline(textStream, line) ) {
+    lineNumber++;
+
+    // Everything after # is a comment
+    size_t commentPos = line.find('#');
+    if ( commentPos != std::string::npos ) line.erase(commentPos);
+
+    std::istringstream lineStream(line);
+    std::vector<std::string> tokens;
+    std::string token;
+    while ( lineStream >> token ) tokens.push_back(token);
+    if ( tokens.empty() ) continue;
+
+    TString error;
+    if ( !ApplyConfigLine(tokens, error) ) {
+      LOG_ERROR << source << ":" << lineNumber << ": " << error << endm;
+      return false;
+    }
+  } //while ( std::getline(textStream, line) )
+
+  // Streams only see the events that pass the global trigger selection
+  for (unsigned int iStream=0; iStream<mStreams.size(); iStream++) {
+    const StPicoEAStream &stream = mStreams[iStream];
+    for (unsigned int iTrg=0; iTrg<stream.triggerIds.size(); iTrg++) {
+      if ( !mTriggerId.empty() &&
+           !std::binary_search(mTriggerId.begin(), mTriggerId.end(), stream.triggerIds[iTrg]) ) {
+        LOG_ERROR << source << ": trigger " << stream.triggerIds[iTrg] << " of stream "
+                  << stream.name << " is not in the trigger list" << endm;
+        return false;
+      }
+    }
+  }
+
+  mConfigText += text;
+  return true;
+}
+
+//________________
+Bool_t StPicoEASkimmer::ApplyConfigLine(const std::vector<std::string> &tokens, TString &error)
+{
+  const std::string &key = tokens[0];
+  const unsigned int nValues = tokens.size() - 1;
+
+  // Ranges: key lo hi
+  Float_t *floatRange = nullptr;
+  Short_t *intRange = nullptr;
+  if      ( key == "vtxZ" )            floatRange = mCutVtxZ;
+  else if ( key == "vtxR" )            floatRange = mCutVtxR;
+  else if ( key == "nHitsRatio" )      floatRange = mCutNHitsRatio;
+  else if ( key == "pt" )              floatRange = mCutPt;
+  else if ( key == "eta" )             floatRange = mCutEta;
+  else if ( key == "treeVtxZ" )        floatRange = mTreeCutVtxZ;
+  else if ( key == "treeVtxR" )        floatRange = mTreeCutVtxR;
+  else if ( key == "treeDeltaVz" )     floatRange = mTreeCutDeltaVz;
+  else if ( key == "treeVtxVpdZ" )     floatRange = mTreeCutVtxVpdZ;
+  else if ( key == "treeNHitsRatio" )  floatRange = mTreeCutNHitsRatio;
+  else if ( key == "treePt" )          floatRange = mTreeCutPt;
+  else if ( key == "treeEta" )         floatRange = mTreeCutEta;
+  else if ( key == "treeDCA" )         floatRange = mTreeCutDCA;
+  else if ( key == "eaPt" )            floatRange = mEAPt;
+  else if ( key == "nHits" )           intRange = mCutNHits;
+  else if ( key == "treeNHits" )       intRange = mTreeCutNHits;
+  else if ( key == "treeNHitsDedx" )   intRange = mTreeCutNHitsDedx;
+
+  if ( floatRange || intRange ) {
+    Double_t lo = 0., hi = 0.;
+    if ( nValues != 2 || !ConfigNumber(tokens[1], lo) || !ConfigNumber(tokens[2], hi) ) {
+      error = Form("%s needs two numbers: lo hi", key.c_str());
+      return false;
+    }
+    if ( lo > hi ) {
+      error = Form("%s: lower limit %g is above the upper limit %g", key.c_str(), lo, hi);
+      return false;
+    }
+    if ( floatRange ) {
+      floatRange[0] = lo; floatRange[1] = hi;
+    }
+    else {
+      if ( lo != (Short_t)lo || hi != (Short_t)hi ) {
+        error = Form("%s needs two integers: lo hi", key.c_str());
+        return false;
+      }
+      intRange[0] = (Short_t)lo; intRange[1] = (Short_t)hi;
+    }
+    return true;
+  }
+
+  // Switches of the optional branches and of the output: key 1|0
+  Bool_t *flag = nullptr;
+  if      ( key == "fillQA" )            flag = &mFillQA;
+  else if ( key == "writeMainTree" )     flag = &mWriteMainTree;
+  else if ( key == "htMatchNeighbours" ) flag = &mHtMatchNeighbours;
+  else if ( key == "findV0" )            flag = &mFindV0;
+  else if ( key == "vertexRefit" )       flag = &mVertexRefit;
+  else if ( key == "sortInputByRun" )    flag = &mSortInputByRun;
+
+  if ( flag ) {
+    if ( nValues != 1 || !ConfigFlag(tokens[1], *flag) ) {
+      error = Form("%s needs one flag: 1|0", key.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  // Non-negative integers: key n
+  if ( key == "treeNPrimariesMin" || key == "maxOutputSize" ||
+       key == "maxEntriesPerFile" || key == "checkpointInterval" ) {
+    Long64_t value = 0;
+    if ( nValues != 1 || !ConfigInteger(tokens[1], value) || value < 0 ) {
+      error = Form("%s needs one non-negative integer", key.c_str());
+      return false;
+    }
+    if      ( key == "treeNPrimariesMin" )  mTreeCutNPrimariesMin = (int)value;
+    else if ( key == "maxOutputSize" )      mMaxOutputSize = value;
+    else if ( key == "maxEntriesPerFile" )  mMaxEntriesPerFile = value;
+    else                                    mCheckpointInterval = (UInt_t)value;
+    return true;
+  }
+
+  if ( key == "eaLeadPtMin" ) {
+    Double_t value = 0.;
+    if ( nValues != 1 || !ConfigNumber(tokens[1], value) ) {
+      error = "eaLeadPtMin needs one number";
+      return false;
+    }
+    mEALeadPtMin = value;
+    return true;
+  }
+
+  // Triggers: trigger id [id ...]
+  if ( key == "trigger" ) {
+    if ( nValues == 0 ) {
+      error = "trigger needs at least one trigger id";
+      return false;
+    }
+    for (unsigned int iValue=1; iValue<=nValues; iValue++) {
+      Long64_t id = 0;
+      if ( !ConfigInteger(tokens[iValue], id) || id < 0 ) {
+        error = Form("trigger: %s is not a trigger id", tokens[iValue].c_str());
+        return false;
+      }
+      addTriggerId( (unsigned int)id );
+    }
+    return true;
+  }
+
+  if ( key == "runIndexMap" ) {
+    if ( nValues != 1 ) {
+      error = "runIndexMap needs one file name";
+      return false;
+    }
+    if ( gSystem->AccessPathName( tokens[1].c_str() ) ) {
+      error = Form("runIndexMap: cannot open %s", tokens[1].c_str());
+      return false;
+    }
+    mRunIndexMap.clear();
+    LoadRunIndexMap( tokens[1].c_str() );
+    return true;
+  }
+
+  // Bad run and bad tower lists
+  if ( key == "badRunList" || key == "badTowerList" ) {
+    if ( nValues != 1 ) {
+      error = Form("%s needs one file name", key.c_str());
+      return false;
+    }
+    Bool_t isRead = ( key == "badRunList" ) ? LoadBadRunList( tokens[1].c_str() ) :
+                                              LoadBadTowerList( tokens[1].c_str() );
+    if ( !isRead ) {
+      error = Form("%s: cannot read %s", key.c_str(), tokens[1].c_str());
+      return false;
+    }
+    return true;
+  }
+
+  // Streams: stream name [fileName]
+  if ( key == "stream" ) {
+    if ( nValues < 1 || nValues > 2 ) {
+      error = "stream needs a name and optionally a file name";
+      return false;
+    }
+    for (unsigned int iStream=0; iStream<mStreams.size(); iStream++) {
+      if ( mStreams[iStream].name == tokens[1].c_str() ) {
+        error = Form("stream %s is defined twice", tokens[1].c_str());
+        return false;
+      }
+    }
+    addStream( tokens[1].c_str(), ( nValues == 2 ) ? tokens[2].c_str() : "" );
+    return true;
+  }
+
+  // Stream settings: key name values
+  if ( key.compare(0, 6, "stream") == 0 ) {
+    if ( nValues < 2 ) {
+      error = Form("%s needs a stream name and values", key.c_str());
+      return false;
+    }
+    StPicoEAStream *stream = nullptr;
+    for (unsigned int iStream=0; iStream<mStreams.size(); iStream++) {
+      if ( mStreams[iStream].name == tokens[1].c_str() ) stream = &mStreams[iStream];
+    }
+    if ( !stream ) {
+      error = Form("%s: stream %s is not defined (stream line missing)", key.c_str(), tokens[1].c_str());
+      return false;
+    }
+    const char *name = tokens[1].c_str();
+
+    if ( key == "streamTrigger" ) {
+      for (unsigned int iValue=2; iValue<=nValues; iValue++) {
+        Long64_t id = 0;
+        if ( !ConfigInteger(tokens[iValue], id) || id < 0 ) {
+          error = Form("streamTrigger: %s is not a trigger id", tokens[iValue].c_str());
+          return false;
+        }
+        addStreamTriggerId( name, (unsigned int)id );
+      }
+      return true;
+    }
+
+    if ( key == "streamNPrimariesMin" ) {
+      Long64_t value = 0;
+      if ( nValues != 2 || !ConfigInteger(tokens[2], value) || value < 0 ) {
+        error = "streamNPrimariesMin needs a stream name and one non-negative integer";
+        return false;
+      }
+      setStreamNPrimariesMin( name, (int)value );
+      return true;
+    }
 
+    if ( key == "streamVtxZ" || key == "streamVtxR" ||
+         key == "streamDeltaVz" || key == "streamVtxVpdZ" ) {
+      Double_t lo = 0., hi = 0.;
+      if ( nValues != 3 || !ConfigNumber(tokens[2], lo) || !ConfigNumber(tokens[3], hi) ) {
+        error = Form("%s needs a stream name and two numbers: lo hi", key.c_str());
+        return false;
+      }
+      if ( lo > hi ) {
+        error = Form("%s: lower limit %g is above the upper limit %g", key.c_str(), lo, hi);
+        return false;
+      }
+      if      ( key == "streamVtxZ" )    setStreamVtxZ( name, lo, hi );
+      else if ( key == "streamVtxR" )    setStreamVtxR( name, lo, hi );
+      else if ( key == "streamDeltaVz" ) setStreamDeltaVz( name, lo, hi );
+      else                               setStreamVtxVpdZ( name, lo, hi );
+      return true;
+    }
+  } //if ( key.compare(0, 6, "stream") == 0 )
+
+  error = Form("unknown key %s", key.c_str());
+  return false;
 }
 
+//________________
+void StPicoEASkimmer::WriteConfig(TFile *file)
+{
+  if ( !file || mConfigText.IsNull() ) return;
+  TDirectory *currentDir = gDirectory;
+  file->cd();
+  TNamed config("PicoEAConfig", mConfigText.Data());
+  config.Write(nullptr, TObject::kOverwrite);
+  currentDir->cd();
+}
+
+
 
 //________________
 Bool_t StPicoEASkimmer::IsGoodTrigger(StPicoEvent *event) {
@@ -410,17 +1726,11 @@ Bool_t StPicoEASkimmer::TrackCutForQA(StPicoTrack *track) {
 }
 
 //________________
-Bool_t StPicoEASkimmer::EventCutForTree(StPicoEvent *event)
+Bool_t StPicoEASkimmer::EventCutForTree(StPicoEvent *event, Int_t nPrimaries)
 {
   // Tree-level event cuts: use a separate set of cuts for skimming
   const TVector3 &vtx = event->primaryVertex();
   float deltaVz = vtx.Z() - event->vzVpd();
-  int nPrimaries = 0; // count primaries manually
-  // Count primary tracks
-  for (unsigned int i=0; i < mPicoDst->numberOfTracks(); ++i) {
-    StPicoTrack *t = mPicoDst->track(i);
-    if (t && t->isPrimary()) ++nPrimaries;
-  }
 
   return ( vtx.Z() >= mTreeCutVtxZ[0] && vtx.Z() <= mTreeCutVtxZ[1] &&
            vtx.Perp() >= mTreeCutVtxR[0] && vtx.Perp() <= mTreeCutVtxR[1] &&
@@ -430,6 +1740,30 @@ Bool_t StPicoEASkimmer::EventCutForTree(StPicoEvent *event)
            IsGoodTrigger(event) );
 }
 
+//________________
+Bool_t StPicoEASkimmer::EventCutForStream(const StPicoEAStream& stream, StPicoEvent *event,
+                                          Int_t nPrimaries)
+{
+  // Stream triggers: at least one of them has to be fired
+  Bool_t isGoodTrigger = stream.triggerIds.empty();
+  for (unsigned int iTrg=0; iTrg<stream.triggerIds.size(); iTrg++) {
+    if ( event->isTrigger( stream.triggerIds[iTrg] ) ) {
+      isGoodTrigger = true;
+      break;
+    }
+  }
+  if ( !isGoodTrigger ) return false;
+
+  // Stream event cuts
+  const TVector3 &vtx = event->primaryVertex();
+  float deltaVz = vtx.Z() - event->vzVpd();
+  return ( vtx.Z() >= stream.cutVtxZ[0] && vtx.Z() <= stream.cutVtxZ[1] &&
+           vtx.Perp() >= stream.cutVtxR[0] && vtx.Perp() <= stream.cutVtxR[1] &&
+           deltaVz >= stream.cutDeltaVz[0] && deltaVz <= stream.cutDeltaVz[1] &&
+           event->vzVpd() >= stream.cutVtxVpdZ[0] && event->vzVpd() <= stream.cutVtxVpdZ[1] &&
+           nPrimaries >= stream.cutNPrimariesMin );
+}
+
 //________________
 Bool_t StPicoEASkimmer::TrackCutForTree(StPicoTrack *track)
 {
@@ -476,10 +1810,16 @@ void StPicoEASkimmer::LoadRunIndexMap(const char* filename) {
     mRunIndexMap[runId] = runIndex++;
   }
 
-  std::cout << "Loaded " << mRunIndexMap.size() << " runs from " << filename << std::endl;
+  if ( mRunIndexMap.empty() ) {
+    LOG_WARN << "No runs in the run index file: " << filename << endm;
+  }
+  else {
+    LOG_INFO << "Loaded " << mRunIndexMap.size() << " runs from " << filename << endm;
+  }
+  WarnBadRunsWithoutIndex();
 }
 
-inline int StPicoEASkimmer::GetRunIndex(int runId) const {
+int StPicoEASkimmer::GetRunIndex(int runId) const {
   // Check if the map is empty or not initialized
   if (mRunIndexMap.empty()) {
     LOG_WARN << "Run index map is empty. Returning -1 for runId: " << runId << endm;
@@ -494,8 +1834,137 @@ inline int StPicoEASkimmer::GetRunIndex(int runId) const {
   }
 }
 
+//________________
+Bool_t StPicoEASkimmer::LoadBadRunList(const char* filename) {
+
+  std::vector<Int_t> ids;
+  if ( !ReadIdList(filename, ids) ) {
+    LOG_ERROR << "Cannot read bad run list: " << filename << endm;
+    return false;
+  }
+  mBadRunIds.swap(ids);
+  LOG_INFO << "Loaded " << mBadRunIds.size() << " bad runs from " << filename << endm;
+  WarnBadRunsWithoutIndex();
+  return true;
+}
+
+//________________
+void StPicoEASkimmer::WarnBadRunsWithoutIndex() const {
+
+  // Without the map Init stops with an error
+  if ( mRunIndexMap.empty() ) return;
+  for (unsigned int iRun=0; iRun<mBadRunIds.size(); iRun++) {
+    if ( mRunIndexMap.find( mBadRunIds[iRun] ) == mRunIndexMap.end() ) {
+      LOG_WARN << "Bad run " << mBadRunIds[iRun] << " is not in the run index map. "
+               << "Its events are not rejected" << endm;
+    }
+  }
+}
+
+//________________
+Bool_t StPicoEASkimmer::LoadBadTowerList(const char* filename) {
+
+  std::vector<Int_t> ids;
+  if ( !ReadIdList(filename, ids) ) {
+    LOG_ERROR << "Cannot read bad tower list: " << filename << endm;
+    return false;
+  }
+  std::bitset<4800> badTowers;
+  for (unsigned int iTower=0; iTower<ids.size(); iTower++) {
+    if ( ids[iTower] < 1 || ids[iTower] > StPicoEABtowGeometry::kNTowers ) {
+      LOG_ERROR << "Bad tower list " << filename << ": softId " << ids[iTower]
+                << " is out of range 1-" << StPicoEABtowGeometry::kNTowers << endm;
+      return false;
+    }
+    badTowers.set( ids[iTower] - 1 );
+  }
+  mBadTowers = badTowers;
+  LOG_INFO << "Loaded " << mBadTowers.count() << " bad towers from " << filename << endm;
+  return true;
+}
+
+//________________
+void StPicoEASkimmer::ResolveRunState(Int_t runId) {
+  mCurrentRunId = runId;
+  mCurrentRunIndex = GetRunIndex(runId);
+  mIsBadRun = ( mCurrentRunIndex >= 0 && mCurrentRunIndex < (Int_t)mBadRunMask.size() &&
+                mBadRunMask[mCurrentRunIndex] );
+  mNRunChanges++;
+  if (mDebug) {
+    LOG_INFO << "New run " << runId << " (run index " << mCurrentRunIndex << ")"
+             << ( mIsBadRun ? ": bad run" : "" ) << endm;
+  }
+}
+
+//________________
+Bool_t StPicoEASkimmer::SkipBadRunEvents() {
+
+  while ( mPicoDstReader->eventCounter() < mPicoDstReader->lastEntry() ) {
+    // Entries that cannot be read are left to readPicoEvent
+    if ( !mPicoDstReader->readEventBranch() ) return true;
+    StPicoEvent *theEvent = mPicoDst->event();
+    if ( !theEvent ) return true;
+    if ( theEvent->runId() != mCurrentRunId ) {
+      ResolveRunState( theEvent->runId() );
+    }
+    if ( !mIsBadRun ) return true;
+    mNBadRunEvents++;
+    mPicoDstReader->skipEntry();
+  }
+  return false;
+}
+
+//________________
+Int_t StPicoEASkimmer::Make() {
+
+  // Stop cleanly before the batch system kills the job
+  if ( mWallClockBudget > 0 ) {
+    Double_t elapsed = mWallClock.RealTime();
+    mWallClock.Continue();
+    if ( elapsed > mWallClockBudget - mWallClockMargin ) {
+      LOG_WARN << "Wall-clock budget is used up (" << elapsed << " s of " << mWallClockBudget
+               << " s) after " << mEventCounter << " events. Stopping." << endm;
+      mIsStoppedOnBudget = true;
+      WriteCheckpoint();
+      return kStEOF;
+    }
+  }
+
+  // Read the next event when the input is not handled by StPicoDstMaker
+  if ( !mIsFromMaker ) {
+    if ( mPicoDstReader->eventCounter() >= mPicoDstReader->lastEntry() ) {
+      mIsEndOfInput = true;
+      return kStEOF;
+    }
+    // Bad runs are rejected before the payload branches are read
+    if ( !mFriendTree && !mBadRunMask.empty() && !SkipBadRunEvents() ) {
+      mIsEndOfInput = true;
+      return kStEOF;
+    }
+    if ( !mPicoDstReader->readPicoEvent( mPicoDstReader->eventCounter() ) ) {
+      // Entries that cannot be read do not complete the input
+      mIsEndOfInput = ( mPicoDstReader->eventCounter() >= mPicoDstReader->lastEntry() );
+      return kStEOF;
+    }
+  }
+
+  Int_t status = ( mFriendTree ) ? MakeAugmentEvent() : MakeEvent();
+
+  // The current event is complete: start a new output part if needed
+  if ( IsRolloverNeeded() ) {
+    RolloverOutputFile();
+  }
+
+  // and checkpoint if it is time to
+  if ( mCheckpointInterval > 0 && (mEventCounter % mCheckpointInterval) == 0 ) {
+    WriteCheckpoint();
+  }
+
+  return status;
+}
+
   //________________
-  Int_t StPicoEASkimmer::Make()
+  Int_t StPicoEASkimmer::MakeEvent()
   {
 
     // Increment event counter
@@ -505,10 +1974,11 @@ inline int StPicoEASkimmer::GetRunIndex(int runId) const {
     // Print event counter
     if ((mEventCounter % 10000) == 0)
     {
-      // Avoid dereferencing mPicoDstMaker if this maker was constructed with a reader
-      if (mPicoDstMaker && mPicoDstMaker->chain())
+      // Input chain of StPicoDstMaker or of StPicoDstReader
+      TChain *chain = InputChain();
+      if (chain)
       {
-        LOG_INFO << "Working on event: " << mEventCounter << "/" << mPicoDstMaker->chain()->GetEntries() << endm;
+        LOG_INFO << "Working on event: " << mEventCounter << "/" << chain->GetEntries() << endm;
       } else {
       LOG_INFO << "Working on event: " << mEventCounter << endm;
     }
@@ -532,6 +2002,15 @@ inline int StPicoEASkimmer::GetRunIndex(int runId) const {
   }
   hEventCounter->Fill(2);
 
+  // Run-level lookups once per run
+  if ( theEvent->runId() != mCurrentRunId ) {
+    ResolveRunState( theEvent->runId() );
+  }
+  if ( mIsBadRun ) {
+    mNBadRunEvents++;
+    return kStOk;
+  }
+
   // Check if event passes event cut (declared and defined in this
   // analysis maker)
   if ( !EventCutForQA(theEvent) ) {
@@ -540,44 +2019,46 @@ inline int StPicoEASkimmer::GetRunIndex(int runId) const {
   hEventCounter->Fill(3);
 
   // Fill event QA histograms
-  hVtxXVsY->Fill(theEvent->primaryVertex().X(), theEvent->primaryVertex().Y());
-  hVtxZ->Fill(theEvent->primaryVertex().Z());
-  hVtxVpdZ->Fill(theEvent->vzVpd());
-  hDeltaVz->Fill(theEvent->primaryVertex().Z() - theEvent->vzVpd());
-  hVtxZVsVpdZ->Fill(theEvent->vzVpd(), theEvent->primaryVertex().Z());
-  hVtxRanking->Fill(theEvent->ranking());
-  hVtxErrorXY->Fill(theEvent->primaryVertexError().Perp());
-  hVtxErrorZ->Fill(theEvent->primaryVertexError().Z());
-  //
-  hRefMult->Fill(theEvent->refMult());
-  hGRefMult->Fill(theEvent->grefMult());
-  hRefMultVsGRefMult->Fill(theEvent->grefMult(), theEvent->refMult());
-  hRefMultVsVz->Fill(theEvent->primaryVertex().Z(), theEvent->refMult());
-  hNBTofMatch->Fill(theEvent->nBTOFMatch());
-  hNBEmcMatch->Fill(theEvent->nBEMCMatch());
-  //
-  hBBCx->Fill(theEvent->BBCx());
-  hZDCx->Fill(theEvent->ZDCx());
-  hVtxErrorXYVsBBCx->Fill(theEvent->BBCx(), theEvent->primaryVertexError().Perp());
-  hVtxErrorZVsBBCx->Fill(theEvent->BBCx(), theEvent->primaryVertexError().Z());
-  hRefMultVsBBCx->Fill(theEvent->BBCx(), theEvent->refMult());
-  hRefMultVsZDCx->Fill(theEvent->ZDCx(), theEvent->refMult());
-  hNBTofMatchVsBBCx->Fill(theEvent->BBCx(), theEvent->nBTOFMatch());
-  hNBTofMatchVsZDCx->Fill(theEvent->ZDCx(), theEvent->nBTOFMatch());
-
-  // BBC QA histograms
-  for (int iBBC=0; iBBC<24; iBBC++) {
-    hBBCEastAdcVsId->Fill(iBBC, theEvent->bbcAdcEast(iBBC));
-    hBBCWestAdcVsId->Fill(iBBC, theEvent->bbcAdcWest(iBBC));
-  }
+  if ( mFillQA ) {
+    hVtxXVsY->Fill(theEvent->primaryVertex().X(), theEvent->primaryVertex().Y());
+    hVtxZ->Fill(theEvent->primaryVertex().Z());
+    hVtxVpdZ->Fill(theEvent->vzVpd());
+    hDeltaVz->Fill(theEvent->primaryVertex().Z() - theEvent->vzVpd());
+    hVtxZVsVpdZ->Fill(theEvent->vzVpd(), theEvent->primaryVertex().Z());
+    hVtxRanking->Fill(theEvent->ranking());
+    hVtxErrorXY->Fill(theEvent->primaryVertexError().Perp());
+    hVtxErrorZ->Fill(theEvent->primaryVertexError().Z());
+    //
+    hRefMult->Fill(theEvent->refMult());
+    hGRefMult->Fill(theEvent->grefMult());
+    hRefMultVsGRefMult->Fill(theEvent->grefMult(), theEvent->refMult());
+    hRefMultVsVz->Fill(theEvent->primaryVertex().Z(), theEvent->refMult());
+    hNBTofMatch->Fill(theEvent->nBTOFMatch());
+    hNBEmcMatch->Fill(theEvent->nBEMCMatch());
+    //
+    hBBCx->Fill(theEvent->BBCx());
+    hZDCx->Fill(theEvent->ZDCx());
+    hVtxErrorXYVsBBCx->Fill(theEvent->BBCx(), theEvent->primaryVertexError().Perp());
+    hVtxErrorZVsBBCx->Fill(theEvent->BBCx(), theEvent->primaryVertexError().Z());
+    hRefMultVsBBCx->Fill(theEvent->BBCx(), theEvent->refMult());
+    hRefMultVsZDCx->Fill(theEvent->ZDCx(), theEvent->refMult());
+    hNBTofMatchVsBBCx->Fill(theEvent->BBCx(), theEvent->nBTOFMatch());
+    hNBTofMatchVsZDCx->Fill(theEvent->ZDCx(), theEvent->nBTOFMatch());
+
+    // BBC QA histograms
+    for (int iBBC=0; iBBC<24; iBBC++) {
+      hBBCEastAdcVsId->Fill(iBBC, theEvent->bbcAdcEast(iBBC));
+      hBBCWestAdcVsId->Fill(iBBC, theEvent->bbcAdcWest(iBBC));
+    }
 
-  // Run dependence QA histograms
-  hBBCxVsRun->Fill(GetRunIndex(theEvent->runId()), theEvent->BBCx());
-  hVtxRankingVsRun->Fill(GetRunIndex(theEvent->runId()), theEvent->ranking());
-  hNTofMatchedTracksVsRun->Fill(GetRunIndex(theEvent->runId()), theEvent->nBTOFMatch());
-  hDeltaVZVsRun->Fill(GetRunIndex(theEvent->runId()), theEvent->primaryVertex().Z() - theEvent->vzVpd());
-  hVtxErrorXYVsRun->Fill(GetRunIndex(theEvent->runId()), theEvent->primaryVertexError().Perp());
-  hVtxErrorZVsRun->Fill(GetRunIndex(theEvent->runId()), theEvent->primaryVertexError().Z());
+    // Run dependence QA histograms
+    hBBCxVsRun->Fill(mCurrentRunIndex, theEvent->BBCx());
+    hVtxRankingVsRun->Fill(mCurrentRunIndex, theEvent->ranking());
+    hNTofMatchedTracksVsRun->Fill(mCurrentRunIndex, theEvent->nBTOFMatch());
+    hDeltaVZVsRun->Fill(mCurrentRunIndex, theEvent->primaryVertex().Z() - theEvent->vzVpd());
+    hVtxErrorXYVsRun->Fill(mCurrentRunIndex, theEvent->primaryVertexError().Perp());
+    hVtxErrorZVsRun->Fill(mCurrentRunIndex, theEvent->primaryVertexError().Z());
+  } // if ( mFillQA )
 
   // Retrieve number of tracks in the event. Make sure that
   // SetStatus("Track*",1) is set to 1. In case of 0 the number
@@ -610,60 +2091,63 @@ inline int StPicoEASkimmer::GetRunIndex(int runId) const {
     hTrackCounter->Fill(4);
     nPrimaries++;
 
-    // Fill primary track histograms
-    hPrimaryPt->Fill(theTrack->pPt());
-    hPrimaryEta->Fill(theTrack->pMom().Eta());
-    hPrimaryPhi->Fill(theTrack->pMom().Phi());
-    hPrimaryEtaVsPhi->Fill(theTrack->pMom().Phi(), theTrack->pMom().Eta());
-    hPrimaryEtaVsPt->Fill(theTrack->pPt(), theTrack->pMom().Eta());
-    hPrimaryPhiVsPt->Fill(theTrack->pPt(), theTrack->pMom().Phi());
-    hPrimaryNHitsFit->Fill(theTrack->nHitsFit());
-    hPrimaryNHitsFitVsPt->Fill(theTrack->pPt(), theTrack->nHitsFit());
-    hPrimaryNHitsDedx->Fill(theTrack->nHitsDedx());
-    hPrimaryNHitsDedxVsPt->Fill(theTrack->pPt(), theTrack->nHitsDedx());
-    if (theTrack->nHitsPoss() > 0) {
-      float nHitsFitRatio = static_cast<float>(theTrack->nHitsFit()) / theTrack->nHitsPoss();
-      hPrimaryNHitsFitRatio->Fill(nHitsFitRatio);
-      hPrimaryNHitsFitRatioVsPt->Fill(theTrack->pPt(), nHitsFitRatio);
-    }
-    hPrimaryChi2->Fill(theTrack->chi2());
-    hPrimaryChi2VsPt->Fill(theTrack->pPt(), theTrack->chi2());
-    // DCA to be stored in absolute values
-    float dca = TMath::Abs(theTrack->gDCA(theEvent->primaryVertex().x(),
-                                         theEvent->primaryVertex().y(),
-                                         theEvent->primaryVertex().z()));
-    float dcaxy = TMath::Abs(theTrack->gDCAxy(theEvent->primaryVertex().x(),
-                                             theEvent->primaryVertex().y()));
-    float dcaz = TMath::Abs(theTrack->gDCAz(theEvent->primaryVertex().z()));
-
-    // Signed DCA: signed distance in xy between the pT vector and the DCA vector (different from DCAxy which is the xy of the DCA vector itself)
-    float dcas = theTrack->gDCAs(theEvent->primaryVertex());
-
-    hPrimaryDCA->Fill(dca);
-    hPrimaryDCAVsPt->Fill(theTrack->pPt(), dca);
-    hPrimaryDCAxy->Fill(dcaxy);
-    hPrimaryDCAs->Fill(dcas);
-    hPrimaryDCAsVsPt->Fill(theTrack->pPt(), dcas);
-    hPrimaryDCAxyVsPt->Fill(theTrack->pPt(), dcaxy);
-    hPrimaryDCAz->Fill(dcaz);
-    hPrimaryDCAzVsPt->Fill(theTrack->pPt(), dcaz);
-    hPrimaryDCAsVsDCAxy->Fill(dcaxy, TMath::Abs(theTrack->gDCAs(theEvent->primaryVertex())));
-    // Fill TPC PID QA histograms
-    hPrimaryTPCDedxVsP->Fill(theTrack->pPtot(), theTrack->dEdx());
-    hPrimaryTPCnSigmaPiVsP->Fill(theTrack->pPtot(), theTrack->nSigmaPion());
-    hPrimaryTPCnSigmaKVsP->Fill(theTrack->pPtot(), theTrack->nSigmaKaon());
-    hPrimaryTPCnSigmaPVsP->Fill(theTrack->pPtot(), theTrack->nSigmaProton());
-    hPrimaryTPCnSigmaEVsP->Fill(theTrack->pPtot(), theTrack->nSigmaElectron());
-    // Run dependent tracking QA histograms
-    hNHitsFitVsRun->Fill(GetRunIndex(theEvent->runId()), theTrack->nHitsFit());
-    hNHitsDedxVsRun->Fill(GetRunIndex(theEvent->runId()), theTrack->nHitsDedx());
-    if (theTrack->nHitsPoss() > 0) {
-      float nHitsFitRatio = static_cast<float>(theTrack->nHitsFit()) / theTrack->nHitsPoss();
-      hNHitsFitRatioVsRun->Fill(GetRunIndex(theEvent->runId()), nHitsFitRatio);
-    }
-    hDCAVsRun->Fill(GetRunIndex(theEvent->runId()), dca);
-    hDedxVsRun->Fill(GetRunIndex(theEvent->runId()), theTrack->dEdx());
-    hChi2VsRun->Fill(GetRunIndex(theEvent->runId()), theTrack->chi2());
+    // Histograms are filled with QA only, the track counter always
+    if ( mFillQA ) {
+      // Fill primary track histograms
+      hPrimaryPt->Fill(theTrack->pPt());
+      hPrimaryEta->Fill(theTrack->pMom().Eta());
+      hPrimaryPhi->Fill(theTrack->pMom().Phi());
+      hPrimaryEtaVsPhi->Fill(theTrack->pMom().Phi(), theTrack->pMom().Eta());
+      hPrimaryEtaVsPt->Fill(theTrack->pPt(), theTrack->pMom().Eta());
+      hPrimaryPhiVsPt->Fill(theTrack->pPt(), theTrack->pMom().Phi());
+      hPrimaryNHitsFit->Fill(theTrack->nHitsFit());
+      hPrimaryNHitsFitVsPt->Fill(theTrack->pPt(), theTrack->nHitsFit());
+      hPrimaryNHitsDedx->Fill(theTrack->nHitsDedx());
+      hPrimaryNHitsDedxVsPt->Fill(theTrack->pPt(), theTrack->nHitsDedx());
+      if (theTrack->nHitsPoss() > 0) {
+        float nHitsFitRatio = static_cast<float>(theTrack->nHitsFit()) / theTrack->nHitsPoss();
+        hPrimaryNHitsFitRatio->Fill(nHitsFitRatio);
+        hPrimaryNHitsFitRatioVsPt->Fill(theTrack->pPt(), nHitsFitRatio);
+      }
+      hPrimaryChi2->Fill(theTrack->chi2());
+      hPrimaryChi2VsPt->Fill(theTrack->pPt(), theTrack->chi2());
+      // DCA to be stored in absolute values
+      float dca = TMath::Abs(theTrack->gDCA(theEvent->primaryVertex().x(),
+                                           theEvent->primaryVertex().y(),
+                                           theEvent->primaryVertex().z()));
+      float dcaxy = TMath::Abs(theTrack->gDCAxy(theEvent->primaryVertex().x(),
+                                               theEvent->primaryVertex().y()));
+      float dcaz = TMath::Abs(theTrack->gDCAz(theEvent->primaryVertex().z()));
+
+      // Signed DCA: signed distance in xy between the pT vector and the DCA vector (different from DCAxy which is the xy of the DCA vector itself)
+      float dcas = theTrack->gDCAs(theEvent->primaryVertex());
+
+      hPrimaryDCA->Fill(dca);
+      hPrimaryDCAVsPt->Fill(theTrack->pPt(), dca);
+      hPrimaryDCAxy->Fill(dcaxy);
+      hPrimaryDCAs->Fill(dcas);
+      hPrimaryDCAsVsPt->Fill(theTrack->pPt(), dcas);
+      hPrimaryDCAxyVsPt->Fill(theTrack->pPt(), dcaxy);
+      hPrimaryDCAz->Fill(dcaz);
+      hPrimaryDCAzVsPt->Fill(theTrack->pPt(), dcaz);
+      hPrimaryDCAsVsDCAxy->Fill(dcaxy, TMath::Abs(theTrack->gDCAs(theEvent->primaryVertex())));
+      // Fill TPC PID QA histograms
+      hPrimaryTPCDedxVsP->Fill(theTrack->pPtot(), theTrack->dEdx());
+      hPrimaryTPCnSigmaPiVsP->Fill(theTrack->pPtot(), theTrack->nSigmaPion());
+      hPrimaryTPCnSigmaKVsP->Fill(theTrack->pPtot(), theTrack->nSigmaKaon());
+      hPrimaryTPCnSigmaPVsP->Fill(theTrack->pPtot(), theTrack->nSigmaProton());
+      hPrimaryTPCnSigmaEVsP->Fill(theTrack->pPtot(), theTrack->nSigmaElectron());
+      // Run dependent tracking QA histograms
+      hNHitsFitVsRun->Fill(mCurrentRunIndex, theTrack->nHitsFit());
+      hNHitsDedxVsRun->Fill(mCurrentRunIndex, theTrack->nHitsDedx());
+      if (theTrack->nHitsPoss() > 0) {
+        float nHitsFitRatio = static_cast<float>(theTrack->nHitsFit()) / theTrack->nHitsPoss();
+        hNHitsFitRatioVsRun->Fill(mCurrentRunIndex, nHitsFitRatio);
+      }
+      hDCAVsRun->Fill(mCurrentRunIndex, dca);
+      hDedxVsRun->Fill(mCurrentRunIndex, theTrack->dEdx());
+      hChi2VsRun->Fill(mCurrentRunIndex, theTrack->chi2());
+    } // if ( mFillQA )
 
     // Accessing TOF PID traits information.
     // TOF information is valid for primary tracks ONLY
@@ -672,18 +2156,22 @@ inline int StPicoEASkimmer::GetRunIndex(int runId) const {
       (StPicoBTofPidTraits*)mPicoDst->btofPidTraits( theTrack->bTofPidTraitsIndex() );
       if (!TofPidTrait) continue;
 
-      // Fill primary track TOF information
-      hPrimaryTofInvBetaVsP->Fill(theTrack->pPtot(), TofPidTrait->btofBeta() > 0 ? 1.0/TofPidTrait->btofBeta() : 10.0);
-      float mass2 = -9999.;
-      if (TofPidTrait->btofBeta() > 0) {
-        float beta = TofPidTrait->btofBeta();
-        mass2 = theTrack->pPtot()*theTrack->pPtot()*(1.0/(beta*beta) - 1.0);
+      if ( mFillQA ) {
+        // Fill primary track TOF information
+        hPrimaryTofInvBetaVsP->Fill(theTrack->pPtot(), TofPidTrait->btofBeta() > 0 ? 1.0/TofPidTrait->btofBeta() : 10.0);
+        float mass2 = -9999.;
+        if (TofPidTrait->btofBeta() > 0) {
+          float beta = TofPidTrait->btofBeta();
+          mass2 = theTrack->pPtot()*theTrack->pPtot()*(1.0/(beta*beta) - 1.0);
+        }
+        hPrimaryTofMass2VsP->Fill(theTrack->pPtot(), mass2);
+        hPrimaryTofEtaVsPhi->Fill(theTrack->pMom().Phi(), theTrack->pMom().Eta());
       }
-      hPrimaryTofMass2VsP->Fill(theTrack->pPtot(), mass2);
-      hPrimaryTofEtaVsPhi->Fill(theTrack->pMom().Phi(), theTrack->pMom().Eta());
     }
     
-    hPrimaryTofMatchVsPt->Fill(theTrack->pPt(), theTrack->isTofTrack() ? 1 : 0);
+    if ( mFillQA ) {
+      hPrimaryTofMatchVsPt->Fill(theTrack->pPt(), theTrack->isTofTrack() ? 1 : 0);
+    }
 
     // Accessing BEMC PID traits information.
     if ( theTrack->isBemcTrack() ) {
@@ -691,40 +2179,58 @@ inline int StPicoEASkimmer::GetRunIndex(int runId) const {
       (StPicoBEmcPidTraits*)mPicoDst->bemcPidTraits( theTrack->bemcPidTraitsIndex() );
       if (!BemcPidTrait) continue;
 
-      // Fill primary track BEMC information
-      hPrimaryBemcE->Fill(BemcPidTrait->bemcE());
-      if (theTrack->pPtot() > 0.0) {
-        hPrimaryBemcEPVsPt->Fill(theTrack->pPt(), BemcPidTrait->bemcE()/theTrack->pPtot());
+      if ( mFillQA ) {
+        // Fill primary track BEMC information
+        hPrimaryBemcE->Fill(BemcPidTrait->bemcE());
+        if (theTrack->pPtot() > 0.0) {
+          hPrimaryBemcEPVsPt->Fill(theTrack->pPt(), BemcPidTrait->bemcE()/theTrack->pPtot());
+        }
+        hPrimaryBemcDeltaZVsPt->Fill(theTrack->pPt(), BemcPidTrait->bemcZDist());
+        hPrimaryBemcDeltaPhiVsPt->Fill(theTrack->pPt(), BemcPidTrait->bemcPhiDist());
+        hPrimaryBemcDeltaZVsDeltaPhi->Fill(BemcPidTrait->bemcPhiDist(), BemcPidTrait->bemcZDist());
+        hPrimaryBsmdNEta->Fill(BemcPidTrait->bemcSmdNEta());
+        hPrimaryBsmdNPhi->Fill(BemcPidTrait->bemcSmdNPhi());
+        hPrimaryBtowDeltaEtaVsDeltaPhi->Fill(BemcPidTrait->btowPhiDist(), BemcPidTrait->btowEtaDist());
+        hPrimaryBemcEtaVsPhi->Fill(theTrack->pMom().Phi(), theTrack->pMom().Eta());
+        hPrimaryBtowE1VsId->Fill(BemcPidTrait->btowId(), BemcPidTrait->btowE());
       }
-      hPrimaryBemcDeltaZVsPt->Fill(theTrack->pPt(), BemcPidTrait->bemcZDist());
-      hPrimaryBemcDeltaPhiVsPt->Fill(theTrack->pPt(), BemcPidTrait->bemcPhiDist());
-      hPrimaryBemcDeltaZVsDeltaPhi->Fill(BemcPidTrait->bemcPhiDist(), BemcPidTrait->bemcZDist());
-      hPrimaryBsmdNEta->Fill(BemcPidTrait->bemcSmdNEta());
-      hPrimaryBsmdNPhi->Fill(BemcPidTrait->bemcSmdNPhi());
-      hPrimaryBtowDeltaEtaVsDeltaPhi->Fill(BemcPidTrait->btowPhiDist(), BemcPidTrait->btowEtaDist());
-      hPrimaryBemcEtaVsPhi->Fill(theTrack->pMom().Phi(), theTrack->pMom().Eta());
-      hPrimaryBtowE1VsId->Fill(BemcPidTrait->btowId(), BemcPidTrait->btowE());
     } 
 
     hTrackCounter->Fill(9);
   }
 
   // Fill QA histograms involving number of primary tracks
-  hNPrimaries->Fill(nPrimaries);
-  hNPrimariesVsBBCx->Fill(theEvent->BBCx(), nPrimaries);
-  hNPrimariesVsZDCx->Fill(theEvent->ZDCx(), nPrimaries);
-  hNPrimariesVsRun->Fill(GetRunIndex(theEvent->runId()), nPrimaries);
+  if ( mFillQA ) {
+    hNPrimaries->Fill(nPrimaries);
+    hNPrimariesVsBBCx->Fill(theEvent->BBCx(), nPrimaries);
+    hNPrimariesVsZDCx->Fill(theEvent->ZDCx(), nPrimaries);
+    hNPrimariesVsRun->Fill(mCurrentRunIndex, nPrimaries);
+  }
 
   hEventCounter->Fill(5);
 
-  // Store skimmed event information in a tree
-  if (!EventCutForTree(theEvent)) {
+  // Count all primary tracks for the tree-level event cuts
+  int nAllPrimaries = 0;
+  for (unsigned int iTrk=0; iTrk<nTracks; iTrk++) {
+    StPicoTrack *t = mPicoDst->track(iTrk);
+    if (t && t->isPrimary()) ++nAllPrimaries;
+  }
+
+  // Store skimmed event information in the main tree and/or the stream trees
+  Bool_t isGoodForTree = mWriteMainTree && EventCutForTree(theEvent, nAllPrimaries);
+  Bool_t isGoodForStreams = false;
+  for (unsigned int iStream=0; iStream<mStreams.size(); iStream++) {
+    mStreams[iStream].isAccepted = EventCutForStream(mStreams[iStream], theEvent, nAllPrimaries);
+    if (mStreams[iStream].isAccepted) isGoodForStreams = true;
+  }
+  if (!isGoodForTree && !isGoodForStreams) {
     return kStOk;
   }
   hEventCounter->Fill(6);
 
   mEventID = theEvent->eventId();
-  mRunIndex = GetRunIndex(theEvent->runId());
+  mRunId = theEvent->runId();
+  mRunIndex = mCurrentRunIndex;
   mVtxR = theEvent->primaryVertex().Perp();
   mVtxZ = theEvent->primaryVertex().Z();
   mVtxVpdZ = theEvent->vzVpd();
@@ -765,6 +2271,7 @@ inline int StPicoEASkimmer::GetRunIndex(int runId) const {
   mHtFlag.clear();
   mHtId.clear();
   mHtAdc.clear();
+  for (unsigned int iHt = 0; iHt < 4; ++iHt) mHtTowers[iHt].reset();
 
   // Loop over all EMC triggers in the event and select only HT triggers (HT0-HT3)
   const unsigned int nEmcTrigs = mPicoDst->numberOfEmcTriggers();
@@ -788,9 +2295,22 @@ inline int StPicoEASkimmer::GetRunIndex(int runId) const {
       Short_t sid = static_cast<Short_t>(etrig->id());     // tower softId
       Short_t sadc = static_cast<Short_t>(etrig->adc());   // ADC value
 
+      // HT triggers on bad towers are dropped
+      if ( IsBadTower(sid - 1) ) {
+        mNBadTowerHts++;
+        continue;
+      }
+
       mHtFlag.push_back(sflag);
       mHtId.push_back(sid);
       mHtAdc.push_back(sadc);
+
+      // Fired-tower bitmap per HT threshold for the track matching
+      if (sid >= 1 && sid <= StPicoEABtowGeometry::kNTowers) {
+        for (unsigned int iHt = 0; iHt < 4; ++iHt) {
+          if (flag & (1u << iHt)) mHtTowers[iHt].set(sid - 1);
+        }
+      }
     }
   }
 
@@ -821,8 +2341,22 @@ inline int StPicoEASkimmer::GetRunIndex(int runId) const {
   mTrackBtowE.clear();
   mTrackBtowPhiDist.clear();
   mTrackBtowEtaDist.clear();
+  mTrackBtowE3x3.clear();
+  mTrackBtowEMaxNb.clear();
+  mTrackHtMatch.clear();
+  mTrackDCAxyUnbiased.clear();
+  mTrackDCAzUnbiased.clear();
+  mTrackDCASig.clear();
   Int_t nTracksForTree = 0;
 
+  // Tower energies are looked up by index for the clusters of matched tracks
+  FillBtowEnergies();
+
+  // Vertex refit with all primaries before the tree tracks are filled
+  if ( mVertexRefit ) {
+    RefitVertex(theEvent);
+  }
+
   // Loop over tracks again to fill track variables
   for (unsigned int iTrk=0; iTrk<nTracks; iTrk++) {
     StPicoTrack *theTrack = (StPicoTrack*)mPicoDst->track(iTrk);
@@ -857,6 +2391,18 @@ inline int StPicoEASkimmer::GetRunIndex(int runId) const {
     mTrackDCAz.push_back(dcaZ);
     mTrackDCAs.push_back(dcaS);
 
+    // DCA to the vertex refitted without the track and its significance
+    if ( mVertexRefit ) {
+      Float_t dcaXYUnbiased = -9999.f, dcaZUnbiased = -9999.f, dcaSig = -9999.f;
+      if ( mIsVertexRefitted &&
+           !mVertexFitter.unbiasedDca(iTrk, dcaXYUnbiased, dcaZUnbiased, dcaSig) ) {
+        dcaXYUnbiased = dcaZUnbiased = dcaSig = -9999.f;
+      }
+      mTrackDCAxyUnbiased.push_back(dcaXYUnbiased);
+      mTrackDCAzUnbiased.push_back(dcaZUnbiased);
+      mTrackDCASig.push_back(dcaSig);
+    }
+
     // TPC PID
     mTrackNSigmaPi.push_back(theTrack->nSigmaPion());
     mTrackNSigmaK.push_back(theTrack->nSigmaKaon());
@@ -888,8 +2434,18 @@ inline int StPicoEASkimmer::GetRunIndex(int runId) const {
       mTrackBTofBeta.push_back(-9999.0f);
       mTrackMass2.push_back(-9999.0f);
     }
+    // Matches to bad towers are stored as no match
+    Int_t towerIndex = theTrack->bemcTowerIndex();
+    Bool_t isBadTowerMatch = IsBadTower(towerIndex);
+    if (theTrack->isBemcTrack() && !isBadTowerMatch && mBadTowers.any()) {
+      StPicoBEmcPidTraits *BemcPidTrait =
+      (StPicoBEmcPidTraits*)mPicoDst->bemcPidTraits(theTrack->bemcPidTraitsIndex());
+      if (BemcPidTrait) isBadTowerMatch = IsBadTower(BemcPidTrait->btowId() - 1);
+    }
+    if (isBadTowerMatch) mNBadTowerTracks++;
+
     // BEMC info (access via bemcPidTraits)
-    if (theTrack->isBemcTrack()) {
+    if (theTrack->isBemcTrack() && !isBadTowerMatch) {
       mTrackIsBemcTrack.push_back(1);
       StPicoBEmcPidTraits *BemcPidTrait =
       (StPicoBEmcPidTraits*)mPicoDst->bemcPidTraits(theTrack->bemcPidTraitsIndex());
@@ -920,10 +2476,43 @@ inline int StPicoEASkimmer::GetRunIndex(int runId) const {
       mTrackBtowPhiDist.push_back(-9999.0f);
       mTrackBtowEtaDist.push_back(-9999.0f);
     }
+
+    // 3x3 tower cluster around the matched tower
+    if (towerIndex >= 0 && towerIndex < StPicoEABtowGeometry::kNTowers && !isBadTowerMatch) {
+      Float_t e3x3 = 0.f, eMaxNb = 0.f;
+      BtowClusterEnergies(towerIndex, e3x3, eMaxNb);
+      mTrackBtowE3x3.push_back(e3x3);
+      mTrackBtowEMaxNb.push_back(eMaxNb);
+      mTrackHtMatch.push_back(HtMatchMask(towerIndex));
+    } else {
+      mTrackBtowE3x3.push_back(-9999.0f);
+      mTrackBtowEMaxNb.push_back(-9999.0f);
+      mTrackHtMatch.push_back(0);
+    }
+    }
+
+    // Event activity from the stored tracks
+    ComputeEAObservables();
+
+    // V0 candidates (only for the events that are stored)
+    if ( mFindV0 && nTracksForTree > 0 ) {
+      FillV0Candidates(theEvent);
     }
 
     hEventCounter->Fill(7);
-    if (nTracksForTree > 0) mEATree->Fill();
+    if (nTracksForTree > 0) {
+      if (isGoodForTree && mEATree) {
+        mRunIndexTable.fill(mRunId, mRunIndex, mEATree->GetEntries(), mEventTriggerIds);
+        mEATree->Fill();
+      }
+      for (unsigned int iStream=0; iStream<mStreams.size(); iStream++) {
+        if (!mStreams[iStream].isAccepted) continue;
+        mStreams[iStream].runIndex.fill(mRunId, mRunIndex, mStreams[iStream].tree->GetEntries(),
+                                        mEventTriggerIds);
+        mStreams[iStream].tree->Fill();
+        mStreams[iStream].nEvents++;
+      }
+    }
 
     hEventCounter->Fill(9);
     return kStOk;
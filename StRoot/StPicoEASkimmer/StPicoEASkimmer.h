@@ -6,7 +6,22 @@
 
 // C++ headers
 #include <vector>
+#include <string>
 #include <iostream>
+#include <map>
+#include <bitset>
+
+// ROOT headers
+#include "TString.h"
+#include "TStopwatch.h"
+
+// StPicoEASkimmer headers
+#include "StPicoEARunIndex.h"
+#include "StPicoEAV0Finder.h"
+#include "StPicoEAVertexFitter.h"
+
+// StPicoEvent headers
+#include "StPicoEvent/StPicoTrackCovArrays.h"
 
 //
 // Forward declarations
@@ -23,11 +38,45 @@ class StPicoTrack;
 
 // ROOT
 class TFile;
+class TTree;
+class TChain;
 class TH1F;
 class TH1D;
 class TH2F;
 class TH2D;
 
+//________________
+/// Output stream of the skimmer. Events that fired at least one of the
+/// stream triggers and pass the stream event cuts are written to the stream
+/// tree in addition to (or instead of) the main EATree. Track cuts are shared.
+struct StPicoEAStream {
+  /// Stream name
+  TString name;
+  /// Trigger IDs that route the event to this stream (sorted)
+  std::vector<unsigned int> triggerIds;
+  /// Output file name. If empty, the tree EATree_<name> is stored
+  /// in the main output file
+  TString fileName;
+  /// Output file (null when the main output file is used)
+  TFile *file;
+  /// Stream tree
+  TTree *tree;
+  /// Event-level cuts. Those not overridden are copied from the tree cuts in Init
+  Float_t cutVtxZ[2];
+  Float_t cutVtxR[2];
+  Float_t cutDeltaVz[2];
+  Float_t cutVtxVpdZ[2];
+  Int_t   cutNPrimariesMin;
+  /// Bit mask of the overridden cuts (see StPicoEASkimmer::EStreamCut)
+  UInt_t  cutOverrides;
+  /// Event has been accepted for this stream
+  Bool_t  isAccepted;
+  /// Number of events written to the stream
+  Long64_t nEvents;
+  /// Entry ranges of the runs in the stream tree
+  StPicoEARunIndex runIndex;
+};
+
 //________________
 class StPicoEASkimmer : public StMaker {
 
@@ -53,15 +102,27 @@ class StPicoEASkimmer : public StMaker {
 
   /// Init method inherited from StMaker
   virtual Int_t Init();
-  /// Make method inherited from StMaker
+  /// Make method inherited from StMaker. When the skimmer reads the input
+  /// with StPicoDstReader, returns kStEOF at the end of the input (or when
+  /// the wall-clock budget is used up)
   virtual Int_t Make();
-  /// Finish method inherited from StMaker
+  /// Finish method inherited from StMaker. In the augmentation mode returns
+  /// kStErr and removes the output when EAFriend does not cover all skim
+  /// entries
   virtual Int_t Finish();
 
   /// Load run index map from a file
   void LoadRunIndexMap(const char* filename);
   /// Get run index for a given run ID
   int GetRunIndex(int runId) const;
+  /// Load the list of bad run IDs. Their events are rejected before the
+  /// event is processed (with StPicoDstReader: before the branches other
+  /// than Event are read). Needs the run index map
+  Bool_t LoadBadRunList(const char* filename);
+  /// Load the list of bad BTOW towers (softId 1-4800): their energies are
+  /// zeroed, HT triggers on them are dropped and track matches to them
+  /// are stored as no match
+  Bool_t LoadBadTowerList(const char* filename);
 
   //
   // Setters
@@ -71,6 +132,9 @@ class StPicoEASkimmer : public StMaker {
   void setDebugStatus(bool status)                      { mDebug = status; }
   /// Set output file name
   void setOutputFileName(const char* name)              { mOutFileName = name; }
+  /// Switch filling of the QA histograms on/off. The QA cuts and the
+  /// counting of primary tracks are applied in both cases
+  void setFillQA(bool fill)                             { mFillQA = fill; }
 
   /// Add trigger id to select. Avoids adding duplicates.
   /// Triggers are the numeric IDs stored in StPicoEvent trigger list.
@@ -108,15 +172,212 @@ class StPicoEASkimmer : public StMaker {
   void setTreeEta(const float& lo, const float& hi)     { mTreeCutEta[0]=lo; mTreeCutEta[1]=hi; }
   void setTreeDCA(const float& lo, const float& hi)     { mTreeCutDCA[0]=lo; mTreeCutDCA[1]=hi; }
 
+  // Event-activity observables (ea_* branches), computed from the tracks
+  // stored in the tree: the leading track and the number of tracks and
+  // their summed pT in the toward (|dphi| < 60 deg), away (|dphi| > 120 deg)
+  // and transverse regions relative to the leading track. TransMax/TransMin
+  // are the two transverse sides with the larger/smaller value.
+
+  /// Minimal pT of the leading track (no leading track - ea_leadPt = -9999)
+  void setEALeadPtMin(const float& pt)                  { mEALeadPtMin = pt; }
+  /// pT range of the tracks counted in the regions
+  void setEAPt(const float& lo, const float& hi)        { mEAPt[0]=lo; mEAPt[1]=hi; }
+
+  // --------------------------
+  // Trigger streams: one read of the input, several skim outputs.
+  // Only events that pass the QA event cut (including the global trigger
+  // list set by addTriggerId) are routed, so stream triggers have to be in
+  // the global list as well. The event-level tree cuts can be overridden per
+  // stream, the track-level tree cuts are shared with the main EATree.
+
+  /// Add output stream. With an empty file name the stream tree
+  /// EATree_<name> is written to the main output file
+  void addStream(const char* name, const char* fileName = "");
+  /// Add trigger id that routes events to the stream
+  void addStreamTriggerId(const char* name, const unsigned int& id);
+  // --------------------------
+  // Checkpointing: every N events the skim trees are AutoSaved, QA
+  // histograms are written and the last completed input file/entry is
+  // recorded in a small text state file. After an eviction the output is
+  // readable up to the last checkpoint and, in resume mode, a rerun
+  // continues from there into <output>_resume<k>.root.
+
+  /// Write a checkpoint every nEvents events (0 - no checkpoints)
+  void setCheckpointInterval(const unsigned int& nEvents) { mCheckpointInterval = nEvents; }
+  /// Name of the checkpoint state file (default: <output file>.state)
+  void setCheckpointFile(const char* name)              { mCheckpointFileName = name; }
+  /// Stop cleanly (kStEOF) when less than margin seconds of the
+  /// wall-clock budget are left (budget <= 0 - no limit)
+  void setWallClockBudget(const double& budget, const double& margin = 600.)
+  { mWallClockBudget = budget; mWallClockMargin = margin; }
+  /// Resume from the checkpoint state file. Works with StPicoDstReader only
+  void setResume(bool resume)                           { mResume = resume; }
+  /// Read the input files ordered by run number (StPicoDstReader only),
+  /// so that the run-level state changes once per run
+  void setSortInputByRun(bool sort)                     { mSortInputByRun = sort; }
+  /// Return StPicoDstReader (nullptr when the input comes from StPicoDstMaker)
+  StPicoDstReader *picoDstReader()                      { return mPicoDstReader; }
+
+  /// Switch off the main EATree (e.g. when only the streams are needed)
+  void setWriteMainTree(bool write)                     { mWriteMainTree = write; }
+  /// Per-stream overrides of the event-level tree cuts
+  void setStreamVtxZ(const char* name, const float& lo, const float& hi);
+  void setStreamVtxR(const char* name, const float& lo, const float& hi);
+  void setStreamDeltaVz(const char* name, const float& lo, const float& hi);
+  void setStreamVtxVpdZ(const char* name, const float& lo, const float& hi);
+  void setStreamNPrimariesMin(const char* name, const int& min);
+
+  // HT trigger matching of the tracks (track_htMatch)
+
+  /// Flag tracks whose 3x3 tower cluster contains an HT-fired tower
+  /// (bits 4-7 of track_htMatch) in addition to the matched tower itself
+  void setHtMatchNeighbours(bool match)                 { mHtMatchNeighbours = match; }
+
+  // V0 finding
+
+  /// Run the V0 (K0s, Lambda) finder on the global tracks and store the
+  /// candidates in the v0_* branches
+  void setFindV0(bool find)                             { mFindV0 = find; }
+  /// V0 finder (e.g. to change its cuts in the steering macro)
+  StPicoEAV0Finder* v0Finder()                          { return &mV0Finder; }
+
+  // Primary vertex refit and unbiased track DCAs
+
+  /// Refit the primary vertex with the track covariance matrices and store
+  /// the vertex (vtxRefit* branches) and, for the tree tracks, the DCA to
+  /// the vertex refitted without the track and its significance
+  /// (track_dcaXYUnbiased, track_dcaZUnbiased, track_dcaSig)
+  void setVertexRefit(bool refit)                       { mVertexRefit = refit; }
+  /// Vertex fitter (e.g. to change its track cuts in the steering macro)
+  StPicoEAVertexFitter* vertexFitter()                  { return &mVertexFitter; }
+
+  // Augmentation mode: instead of a new skim, read an existing skim output
+  // together with its source picoDst files and write only additional track
+  // branches into the entry-aligned friend tree EAFriend. Events are aligned
+  // by runId/eventID and the tracks by the tree-level track cuts, which must
+  // be the same as in the original skim (track_pt is compared per track).
+  // Usage: EATree->AddFriend("EAFriend", "friend.root")
+
+  /// Name of the existing skim file (and its tree) to augment
+  void setAugmentFile(const char* skimFileName, const char* treeName = "EATree")
+  { mAugmentFileName = skimFileName; mAugmentTreeName = treeName; }
+
+  // Output rollover: when a limit is set, the output is written to
+  // <output stem>_part000.root, _part001.root, ... A new part is started
+  // after the event that reaches the limit. Each part holds its own trees,
+  // run index and QA histograms (filled with the events of this part only,
+  // so hadd of the parts gives the full statistics). Streams with their own
+  // files are not split.
+
+  /// Start a new output file when the compressed size written so far
+  /// reaches the limit (bytes, 0 - no limit)
+  void setMaxOutputSize(const Long64_t& bytes)          { mMaxOutputSize = bytes; }
+  /// Start a new output file when the skim tree reaches the number of
+  /// entries (0 - no limit)
+  void setMaxEntriesPerFile(const Long64_t& nEntries)   { mMaxEntriesPerFile = nEntries; }
+
+  // --------------------------
+  // Configuration file: QA and tree cuts, triggers, streams, optional
+  // branches and output options as plain "key values" lines (see
+  // picoEASkim.cfg). The file is read and validated in Init, after the
+  // setters (values in the file win, triggers are added to the list), and
+  // stored verbatim in every output file as the TNamed PicoEAConfig.
+
+  /// Name of the configuration file (empty - only the setters are used)
+  void setConfigFile(const char* name)                  { mConfigFileName = name; }
+  /// Apply configuration text. Returns false at the first invalid line
+  Bool_t applyConfig(const char* text, const char* source = "config");
+
 
  private:
 
+  /// Process the current event
+  Int_t MakeEvent();
+
+  /// Open the skim file to augment and create the friend tree
+  Int_t InitAugment();
+  /// Fill the friend tree entry when the event is the next skim entry
+  Int_t MakeAugmentEvent();
+
+  /// Flush skim trees and histograms to the output so that it is readable
+  /// up to the current event, then write the state file
+  void WriteCheckpoint();
+
+  /// Write run index tables of the main and stream trees
+  void WriteRunIndex();
+
+  /// Write state file with the current input file/entry
+  void WriteStateFile(Bool_t isComplete);
+  /// Input chain of StPicoDstMaker or StPicoDstReader
+  TChain* InputChain() const;
+
+  /// Name of the output part
+  TString PartFileName(Int_t part) const;
+  /// Output file has reached the size or entry limit
+  Bool_t IsRolloverNeeded();
+  /// Close the current output part and continue in the next one
+  void RolloverOutputFile();
+
   /// Create histograms
   void CreateHistograms();
 
   /// Create the skim tree and define branches
   void CreateEATree();
 
+  /// Define EATree branches for the given tree. All trees (main and
+  /// streams) share the same buffers
+  void BookEATreeBranches(TTree *tree);
+
+  /// Fill the dense tower energy array from StPicoBTowHit
+  void FillBtowEnergies();
+  /// 3x3 cluster energy and the highest neighbour energy around the tower
+  /// index (0-4799) from the dense tower energy array
+  void BtowClusterEnergies(Int_t towerIndex, Float_t &e3x3, Float_t &eMaxNeighbour) const;
+  /// Leading track and region observables from the stored track vectors
+  void ComputeEAObservables();
+
+  /// Find the V0 candidates of the event and fill the v0_* vectors
+  void FillV0Candidates(StPicoEvent *event);
+  /// Refit the primary vertex of the event and fill the vtxRefit* values
+  void RefitVertex(StPicoEvent *event);
+
+  /// Resolve the run-level state (run index, bad run) when the run changes.
+  /// The event and track loops use the cached values only
+  void ResolveRunState(Int_t runId);
+  /// Warn about the bad runs that are not in the run index map: they get
+  /// no bit in the bad run mask and their events are accepted
+  void WarnBadRunsWithoutIndex() const;
+  /// Skip the events of bad runs reading only the Event branch
+  /// (StPicoDstReader). Returns false at the end of the input
+  Bool_t SkipBadRunEvents();
+  /// Tower index (softId-1) is in the bad tower mask
+  Bool_t IsBadTower(Int_t towerIndex) const
+  { return ( towerIndex >= 0 && towerIndex < 4800 && mBadTowers.test(towerIndex) ); }
+
+  /// Bit mask of the HT thresholds fired by the tower index (bits 0-3) and,
+  /// with setHtMatchNeighbours, by its 3x3 cluster (bits 4-7)
+  Short_t HtMatchMask(Int_t towerIndex) const;
+
+  /// Create stream trees (and files)
+  void CreateStreams();
+  /// Create the stream tree in its file or in the main output file
+  void CreateStreamTree(StPicoEAStream &stream);
+
+  /// Return stream with the given name or nullptr
+  StPicoEAStream* FindStream(const char* name);
+
+  /// Read and apply the configuration file
+  Bool_t ReadConfigFile();
+  /// Apply one line of the configuration. Returns false when the key is
+  /// unknown or the values are invalid (error in the message)
+  Bool_t ApplyConfigLine(const std::vector<std::string> &tokens, TString &error);
+  /// Store the configuration text in the file
+  void WriteConfig(TFile *file);
+
+  /// Bits of the overridden stream event cuts
+  enum EStreamCut { kStreamVtxZ = 0x1, kStreamVtxR = 0x2, kStreamDeltaVz = 0x4,
+                    kStreamVtxVpdZ = 0x8, kStreamNPrimariesMin = 0x10 };
+
   /// Check the at least one triggers to select is in the event triggers list
   Bool_t IsGoodTrigger(StPicoEvent *event);
 
@@ -127,13 +388,19 @@ class StPicoEASkimmer : public StMaker {
   Bool_t TrackCutForQA(StPicoTrack *track);
 
   /// Event cut for skimming to smaller trees
-  Bool_t EventCutForTree(StPicoEvent *event);
+  Bool_t EventCutForTree(StPicoEvent *event, Int_t nPrimaries);
+
+  /// Event cut for the stream trees (stream triggers and stream event cuts)
+  Bool_t EventCutForStream(const StPicoEAStream& stream, StPicoEvent *event,
+                           Int_t nPrimaries);
 
   /// Track cut for skimming to smaller trees
   Bool_t TrackCutForTree(StPicoTrack *track);
 
   /// Debug mode
   Bool_t mDebug;
+  /// Fill QA histograms
+  Bool_t mFillQA;
 
   /// List of triggers to select
   std::vector<unsigned int> mTriggerId;
@@ -169,12 +436,51 @@ class StPicoEASkimmer : public StMaker {
   Float_t mTreeCutDCA[2];
 
   /// Output file name
-  const char* mOutFileName;
+  TString mOutFileName;
   /// Output file
   TFile *mOutFile;
 
+  /// Output rollover limits (0 - no limit)
+  Long64_t mMaxOutputSize;
+  Long64_t mMaxEntriesPerFile;
+  /// Output file name without .root, used for the part names
+  TString mOutFileStem;
+  /// Current output part
+  Int_t mOutFilePart;
+
+  /// Checkpoint every N events
+  UInt_t mCheckpointInterval;
+  /// Checkpoint state file name
+  TString mCheckpointFileName;
+  /// Wall-clock budget and safety margin (seconds)
+  Double_t mWallClockBudget;
+  Double_t mWallClockMargin;
+  /// Wall clock since Init
+  TStopwatch mWallClock;
+  /// Processing has been stopped because of the wall-clock budget
+  Bool_t mIsStoppedOnBudget;
+  /// All of the input has been read (StPicoDstReader or the skim to augment)
+  Bool_t mIsEndOfInput;
+  /// Resume from the state file
+  Bool_t mResume;
+  /// Number of previous resumes (from the state file)
+  Int_t mResumeCount;
+
   // Run index map
   std::map<int, int> mRunIndexMap;
+  /// Order the reader input by run number
+  Bool_t mSortInputByRun;
+  /// Run of the run-level state, its run index and the number of run changes
+  Int_t mCurrentRunId;
+  Int_t mCurrentRunIndex;
+  Long64_t mNRunChanges;
+  /// Bad run IDs from the list and the mask of the bad runs by run index
+  std::vector<Int_t> mBadRunIds;
+  std::vector<bool> mBadRunMask;
+  /// The current run is bad
+  Bool_t mIsBadRun;
+  /// Number of rejected events of bad runs
+  Long64_t mNBadRunEvents;
   
   /// Pointer to StPicoDstMaker
   StPicoDstMaker *mPicoDstMaker;
@@ -288,9 +594,16 @@ class StPicoEASkimmer : public StMaker {
 
   // Skim tree
   TTree *mEATree;
+  /// Write the main skim tree
+  Bool_t mWriteMainTree;
+  /// Trigger streams
+  std::vector<StPicoEAStream> mStreams;
+  /// Entry ranges of the runs in the main tree
+  StPicoEARunIndex mRunIndexTable;
 
   // Event-level variables for tree
   Int_t mEventID;
+  Int_t mRunId;
   Int_t mRunIndex;
   Float_t mVtxR;
   Float_t mVtxZ;
@@ -306,6 +619,24 @@ class StPicoEASkimmer : public StMaker {
   Float_t mZDCx;
   Int_t mNPrimaries;
 
+  // Event-activity observables
+  Float_t mEALeadPtMin;
+  Float_t mEAPt[2];
+  Int_t   mEALeadIndex;
+  Float_t mEALeadPt;
+  Float_t mEALeadEta;
+  Float_t mEALeadPhi;
+  Int_t   mEANToward;
+  Int_t   mEANAway;
+  Int_t   mEANTrans;
+  Int_t   mEANTransMax;
+  Int_t   mEANTransMin;
+  Float_t mEASumPtToward;
+  Float_t mEASumPtAway;
+  Float_t mEASumPtTrans;
+  Float_t mEASumPtTransMax;
+  Float_t mEASumPtTransMin;
+
   // Trigger IDs that fired for the current event (stored in the tree)
   std::vector<unsigned int> mEventTriggerIds;
 
@@ -346,6 +677,95 @@ class StPicoEASkimmer : public StMaker {
   std::vector<Float_t> mTrackBtowE;
   std::vector<Float_t> mTrackBtowPhiDist;
   std::vector<Float_t> mTrackBtowEtaDist;
+  std::vector<Float_t> mTrackBtowE3x3;
+  std::vector<Float_t> mTrackBtowEMaxNb;
+
+  /// Energies of the 4800 BTOW towers in the current event (index = softId-1)
+  Float_t mBtowEnergy[4800];
+
+  /// Towers fired by HT0-HT3 in the current event (index = softId-1)
+  std::bitset<4800> mHtTowers[4]; //!
+  /// Bad towers (index = softId-1)
+  std::bitset<4800> mBadTowers; //!
+  /// Numbers of track matches and of HT triggers dropped on bad towers
+  Long64_t mNBadTowerTracks;
+  Long64_t mNBadTowerHts;
+  /// Also match HT towers in the 3x3 cluster of the track tower
+  Bool_t mHtMatchNeighbours;
+  /// Per track: bit i - matched tower fired HTi, bit 4+i - a tower of
+  /// the 3x3 cluster fired HTi (with setHtMatchNeighbours)
+  std::vector<Short_t> mTrackHtMatch;
+
+  // V0 candidates
+  Bool_t mFindV0;
+  StPicoEAV0Finder mV0Finder; //!
+  std::vector<Float_t> mV0MassK0s;
+  std::vector<Float_t> mV0MassLambda;
+  std::vector<Float_t> mV0MassAntiLambda;
+  std::vector<Float_t> mV0Pt;
+  std::vector<Float_t> mV0Eta;
+  std::vector<Float_t> mV0Phi;
+  std::vector<Float_t> mV0DecayLength;
+  std::vector<Float_t> mV0DcaDaughters;
+  std::vector<Float_t> mV0DcaToPV;
+  std::vector<Float_t> mV0CosPointing;
+  std::vector<Float_t> mV0PosDca;
+  std::vector<Float_t> mV0NegDca;
+  std::vector<Float_t> mV0PosNSigmaPi;
+  std::vector<Float_t> mV0PosNSigmaP;
+  std::vector<Float_t> mV0NegNSigmaPi;
+  std::vector<Float_t> mV0NegNSigmaP;
+
+  // Primary vertex refit
+  Bool_t mVertexRefit;
+  StPicoTrackCovArrays mTrackCovArrays; //!
+  StPicoEAVertexFitter mVertexFitter; //!
+  Bool_t mIsVertexRefitted;
+  Long64_t mNVertexRefits;
+  Long64_t mNVertexRefitsFailed;
+  Long64_t mNVertexRefitsNoCov;
+  Float_t mVtxRefitX;
+  Float_t mVtxRefitY;
+  Float_t mVtxRefitZ;
+  Float_t mVtxRefitErrorX;
+  Float_t mVtxRefitErrorY;
+  Float_t mVtxRefitErrorZ;
+  Float_t mVtxRefitChi2Ndf;
+  /// Sum of the track weights (effective number of tracks)
+  Float_t mVtxRefitSumW;
+  std::vector<Float_t> mTrackDCAxyUnbiased;
+  std::vector<Float_t> mTrackDCAzUnbiased;
+  std::vector<Float_t> mTrackDCASig;
+
+  // Configuration file and its text
+  TString mConfigFileName;
+  TString mConfigText;
+
+  // Augmentation mode
+  TString mAugmentFileName;
+  TString mAugmentTreeName;
+  TFile *mAugmentFile;
+  /// Existing skim tree
+  TTree *mAugmentTree;
+  /// Friend tree with the new branches
+  TTree *mFriendTree;
+  /// Next skim entry to be matched
+  Long64_t mAugmentEntry;
+  /// Number of skim entries with a different track selection
+  Long64_t mAugmentNMismatches;
+  /// Skim tree has the runId branch (older skims have eventID only)
+  Bool_t mAugmentHasRunId;
+  Int_t mAugmentEventID;
+  Int_t mAugmentRunId;
+  std::vector<Float_t> *mAugmentTrackPt;
+
+  // New track-level branches of the friend tree
+  std::vector<Float_t> mTrackDNdx;
+  std::vector<Float_t> mTrackDNdxError;
+  std::vector<UInt_t>  mTrackTopoMap0;
+  std::vector<UInt_t>  mTrackTopoMap1;
+  std::vector<Float_t> mTrackBTofYLocal;
+  std::vector<Float_t> mTrackBTofZLocal;
 
   /// Event counter
   UInt_t mEventCounter;
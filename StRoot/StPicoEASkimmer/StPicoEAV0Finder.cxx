@@ -0,0 +1,213 @@
+// C++ headers
+#include <cmath>
+#include <utility>
+
+// StPicoEASkimmer headers
+#include "StPicoEAV0Finder.h"
+
+// StPicoEvent headers
+#include "StPicoEvent/StPicoDst.h"
+#include "StPicoEvent/StPicoTrack.h"
+
+// ROOT headers
+#include "TMath.h"
+
+// Daughter masses (GeV/c^2)
+namespace {
+  const Double_t kMassPion = 0.13957039;
+  const Double_t kMassProton = 0.93827209;
+}
+
+//________________
+StPicoEAV0Finder::StPicoEAV0Finder() :
+  mDaughterPtMin(0.15), mDaughterNHitsFitMin(15), mDaughterDcaMin(0.3),
+  mDcaDaughtersMax(1.0), mDecayLengthMin(2.0), mCosPointingMin(0.99),
+  mDcaToPVMax(1.0), mPreselectionZTolerance(1.0),
+  mHelixBatch(), mBatchTrackIndex(), mPositive(), mNegative(), mCandidates(),
+  mNPairs(0), mNPreselectedPairs(0), mNCandidates(0) {
+  // Mass windows around the K0s and Lambda masses
+  mMassK0s[0] = 0.45; mMassK0s[1] = 0.55;
+  mMassLambda[0] = 1.09; mMassLambda[1] = 1.14;
+}
+
+//________________
+StPicoEAV0Finder::~StPicoEAV0Finder() {
+  /* empty */
+}
+
+//________________
+void StPicoEAV0Finder::find(StPicoDst *dst, const TVector3& pVtx, Float_t bField) {
+
+  mCandidates.clear();
+  mPositive.clear();
+  mNegative.clear();
+
+  // Helix DCA to the primary vertex of the tracks passing the pT and
+  // nHitsFit cuts in one pass. mBatchTrackIndex maps the batch slots
+  // back to the track indices
+  const Int_t nTracks = dst->numberOfTracks();
+  mHelixBatch.clear();
+  mHelixBatch.reserve(nTracks);
+  mBatchTrackIndex.clear();
+  for (Int_t iTrk=0; iTrk<nTracks; iTrk++) {
+    StPicoTrack *track = dst->track(iTrk);
+    if ( !track ) continue;
+    if ( track->gPt() < mDaughterPtMin ) continue;
+    if ( track->nHitsFit() < mDaughterNHitsFitMin ) continue;
+    mHelixBatch.add( *track, bField );
+    mBatchTrackIndex.push_back(iTrk);
+  }
+  std::vector<Double_t> dcaToPV;
+  mHelixBatch.distance(pVtx, dcaToPV);
+
+  // Daughter preselection, split by charge
+  for (unsigned int iSlot=0; iSlot<mBatchTrackIndex.size(); iSlot++) {
+    const Int_t iTrk = mBatchTrackIndex[iSlot];
+    StPicoTrack *track = dst->track(iTrk);
+    if ( dcaToPV[iSlot] < mDaughterDcaMin ) continue;
+
+    Daughter daughter;
+    daughter.index = iTrk;
+    daughter.helix = track->helix(bField);
+    // Straight lines (no field) are not handled by the circle preselection
+    if ( daughter.helix.curvature() <= 0. ) continue;
+    daughter.xCenter = daughter.helix.xcenter();
+    daughter.yCenter = daughter.helix.ycenter();
+    daughter.radius = 1. / daughter.helix.curvature();
+    daughter.dca = dcaToPV[iSlot];
+
+    if ( track->charge() > 0 ) mPositive.push_back(daughter);
+    else if ( track->charge() < 0 ) mNegative.push_back(daughter);
+  } //for (unsigned int iSlot=0; iSlot<mBatchTrackIndex.size(); iSlot++)
+
+  // Pairs of the opposite charge
+  for (unsigned int iPos=0; iPos<mPositive.size(); iPos++) {
+    for (unsigned int iNeg=0; iNeg<mNegative.size(); iNeg++) {
+      mNPairs++;
+      if ( !IsPairPreselected(mPositive[iPos], mNegative[iNeg]) ) continue;
+      mNPreselectedPairs++;
+
+      StPicoEAV0Candidate v0;
+      if ( !MakeCandidate(mPositive[iPos], mNegative[iNeg], pVtx, bField * kilogauss, v0) ) continue;
+      mCandidates.push_back(v0);
+      mNCandidates++;
+    }
+  }
+}
+
+//________________
+Bool_t StPicoEAV0Finder::IsPairPreselected(const Daughter& pos, const Daughter& neg) const {
+
+  // Relative position of the circle centres in the xy-plane
+  Double_t dx = neg.xCenter - pos.xCenter;
+  Double_t dy = neg.yCenter - pos.yCenter;
+  Double_t d = TMath::Sqrt(dx * dx + dy * dy);
+  if ( d <= 0. ) return false;
+  Double_t ux = dx / d;
+  Double_t uy = dy / d;
+  Double_t r1 = pos.radius;
+  Double_t r2 = neg.radius;
+
+  // Crossing points of the circles or, when they do not cross, the point
+  // of the closest approach of the circles
+  Double_t px[2], py[2];
+  Int_t nPoints = 1;
+  if ( d > r1 + r2 ) {
+    Double_t gap = d - r1 - r2;
+    if ( gap > mDcaDaughtersMax ) return false;
+    px[0] = pos.xCenter + ( r1 + 0.5 * gap ) * ux;
+    py[0] = pos.yCenter + ( r1 + 0.5 * gap ) * uy;
+  }
+  else if ( d < TMath::Abs(r1 - r2) ) {
+    Double_t gap = TMath::Abs(r1 - r2) - d;
+    if ( gap > mDcaDaughtersMax ) return false;
+    if ( r1 > r2 ) {
+      px[0] = pos.xCenter + ( r1 - 0.5 * gap ) * ux;
+      py[0] = pos.yCenter + ( r1 - 0.5 * gap ) * uy;
+    }
+    else {
+      px[0] = neg.xCenter - ( r2 - 0.5 * gap ) * ux;
+      py[0] = neg.yCenter - ( r2 - 0.5 * gap ) * uy;
+    }
+  }
+  else {
+    Double_t a = ( r1 * r1 - r2 * r2 + d * d ) / ( 2. * d );
+    Double_t h = TMath::Sqrt( TMath::Max(r1 * r1 - a * a, 0.) );
+    nPoints = 2;
+    px[0] = pos.xCenter + a * ux - h * uy;
+    py[0] = pos.yCenter + a * uy + h * ux;
+    px[1] = pos.xCenter + a * ux + h * uy;
+    py[1] = pos.yCenter + a * uy - h * ux;
+  }
+
+  // z of the two helices at the point (path length of the xy DCA, analytic)
+  const Double_t maxDz = mDcaDaughtersMax + mPreselectionZTolerance;
+  for (Int_t iPoint=0; iPoint<nPoints; iPoint++) {
+    Double_t zPos = pos.helix.z( pos.helix.pathLength(px[iPoint], py[iPoint]) );
+    Double_t zNeg = neg.helix.z( neg.helix.pathLength(px[iPoint], py[iPoint]) );
+    if ( TMath::Abs(zPos - zNeg) < maxDz ) return true;
+  }
+  return false;
+}
+
+//________________
+Bool_t StPicoEAV0Finder::MakeCandidate(const Daughter& pos, const Daughter& neg,
+                                       const TVector3& pVtx, Double_t bField,
+                                       StPicoEAV0Candidate& v0) const {
+
+  // Full helix pair DCA
+  std::pair<Double_t, Double_t> s = pos.helix.pathLengths(neg.helix);
+  if ( s.first >= StPicoHelix::NoSolution || s.second >= StPicoHelix::NoSolution ) return false;
+  TVector3 posAtDca = pos.helix.at(s.first);
+  TVector3 negAtDca = neg.helix.at(s.second);
+  Double_t dcaDaughters = (posAtDca - negAtDca).Mag();
+  if ( dcaDaughters > mDcaDaughtersMax ) return false;
+
+  // Decay vertex and topology
+  TVector3 decayVertex = 0.5 * (posAtDca + negAtDca);
+  TVector3 posMom = pos.helix.momentumAt(s.first, bField);
+  TVector3 negMom = neg.helix.momentumAt(s.second, bField);
+  TVector3 v0Mom = posMom + negMom;
+  TVector3 decayLine = decayVertex - pVtx;
+  Double_t decayLength = decayLine.Mag();
+  if ( decayLength < mDecayLengthMin ) return false;
+  Double_t v0Ptot = v0Mom.Mag();
+  if ( v0Ptot <= 0. ) return false;
+  Double_t cosPointing = decayLine.Dot(v0Mom) / (decayLength * v0Ptot);
+  if ( cosPointing < mCosPointingMin ) return false;
+  Double_t dcaToPV = decayLine.Cross(v0Mom).Mag() / v0Ptot;
+  if ( dcaToPV > mDcaToPVMax ) return false;
+
+  // Invariant masses under the three hypotheses
+  Double_t posP2 = posMom.Mag2();
+  Double_t negP2 = negMom.Mag2();
+  Double_t v0P2 = v0Ptot * v0Ptot;
+  Double_t posEPion = TMath::Sqrt(posP2 + kMassPion * kMassPion);
+  Double_t posEProton = TMath::Sqrt(posP2 + kMassProton * kMassProton);
+  Double_t negEPion = TMath::Sqrt(negP2 + kMassPion * kMassPion);
+  Double_t negEProton = TMath::Sqrt(negP2 + kMassProton * kMassProton);
+  Double_t massK0s = TMath::Sqrt( TMath::Max( TMath::Power(posEPion + negEPion, 2) - v0P2, 0. ) );
+  Double_t massLambda = TMath::Sqrt( TMath::Max( TMath::Power(posEProton + negEPion, 2) - v0P2, 0. ) );
+  Double_t massAntiLambda = TMath::Sqrt( TMath::Max( TMath::Power(posEPion + negEProton, 2) - v0P2, 0. ) );
+
+  Bool_t isK0s = ( massK0s >= mMassK0s[0] && massK0s <= mMassK0s[1] );
+  Bool_t isLambda = ( massLambda >= mMassLambda[0] && massLambda <= mMassLambda[1] );
+  Bool_t isAntiLambda = ( massAntiLambda >= mMassLambda[0] && massAntiLambda <= mMassLambda[1] );
+  if ( !isK0s && !isLambda && !isAntiLambda ) return false;
+
+  v0.posIndex = pos.index;
+  v0.negIndex = neg.index;
+  v0.massK0s = massK0s;
+  v0.massLambda = massLambda;
+  v0.massAntiLambda = massAntiLambda;
+  v0.pt = v0Mom.Perp();
+  v0.eta = v0Mom.Eta();
+  v0.phi = v0Mom.Phi();
+  v0.decayLength = decayLength;
+  v0.dcaDaughters = dcaDaughters;
+  v0.dcaToPV = dcaToPV;
+  v0.cosPointing = cosPointing;
+  v0.posDca = pos.dca;
+  v0.negDca = neg.dca;
+  return true;
+}
@@ -0,0 +1,148 @@
+#ifndef StPicoEAV0Finder_h
+#define StPicoEAV0Finder_h
+
+// C++ headers
+#include <vector>
+
+// ROOT headers
+#include "Rtypes.h"
+#include "TVector3.h"
+
+// StPicoEvent headers
+#include "StPicoEvent/StPicoPhysicalHelix.h"
+#include "StPicoEvent/StPicoHelixBatch.h"
+
+//
+// Forward declarations
+//
+
+class StPicoDst;
+
+//________________
+/// V0 candidate (K0s, Lambda or anti-Lambda) built from a pair of
+/// oppositely charged global tracks
+struct StPicoEAV0Candidate {
+  /// Indices of the positive and negative daughters in the picoDst
+  Int_t posIndex;
+  Int_t negIndex;
+  /// Invariant masses: pi+pi-, p pi-, pi+ pbar
+  Float_t massK0s;
+  Float_t massLambda;
+  Float_t massAntiLambda;
+  /// V0 momentum at the decay vertex
+  Float_t pt;
+  Float_t eta;
+  Float_t phi;
+  /// Distance between the primary vertex and the decay vertex
+  Float_t decayLength;
+  /// Distance of closest approach between the daughters
+  Float_t dcaDaughters;
+  /// DCA of the V0 line of flight to the primary vertex
+  Float_t dcaToPV;
+  /// Cosine of the pointing angle (decay length vs V0 momentum)
+  Float_t cosPointing;
+  /// DCA of the daughter helices to the primary vertex
+  Float_t posDca;
+  Float_t negDca;
+};
+
+//________________
+/// V0 finder for the skimmer. Pairs of positive and negative global tracks
+/// are tested with cheap analytic conditions before the full helix pair DCA
+/// (StPicoHelix::pathLengths) is computed:
+///  - daughters are preselected by pT, nHitsFit and the helix DCA to the
+///    primary vertex (all tracks at once with StPicoHelixBatch)
+///  - the xy circles of the two helices must intersect or come closer than
+///    the maximal daughter DCA
+///  - at the intersection point(s) the z of the two helices must agree
+///    within the maximal daughter DCA plus a tolerance
+/// Candidates passing the topological cuts and at least one mass window
+/// are kept. The pairs are not binned in phi or dip: such bins would drop
+/// the wide opening angle V0s at low pT, and the analytic tests above
+/// already keep the helix pair DCA away from most of the pairs.
+class StPicoEAV0Finder {
+
+ public:
+  /// Constructor
+  StPicoEAV0Finder();
+  /// Destructor
+  virtual ~StPicoEAV0Finder();
+
+  /// Daughter cuts
+  void setDaughterPtMin(const float& pt)                { mDaughterPtMin = pt; }
+  void setDaughterNHitsFitMin(const int& nHits)         { mDaughterNHitsFitMin = nHits; }
+  void setDaughterDcaMin(const float& dca)              { mDaughterDcaMin = dca; }
+  /// Topological cuts
+  void setDcaDaughtersMax(const float& dca)             { mDcaDaughtersMax = dca; }
+  void setDecayLengthMin(const float& length)           { mDecayLengthMin = length; }
+  void setCosPointingMin(const float& cosPointing)      { mCosPointingMin = cosPointing; }
+  void setDcaToPVMax(const float& dca)                  { mDcaToPVMax = dca; }
+  /// Mass windows: a candidate is kept when one of the masses is inside
+  void setMassWindowK0s(const float& lo, const float& hi)    { mMassK0s[0]=lo; mMassK0s[1]=hi; }
+  void setMassWindowLambda(const float& lo, const float& hi) { mMassLambda[0]=lo; mMassLambda[1]=hi; }
+  /// Additional z tolerance of the analytic pair preselection (cm)
+  void setPreselectionZTolerance(const float& dz)       { mPreselectionZTolerance = dz; }
+
+  /// Find the V0 candidates of the current event
+  /// \param bField Magnetic field (kilogauss)
+  void find(StPicoDst *dst, const TVector3& pVtx, Float_t bField);
+
+  /// Candidates of the last event
+  const std::vector<StPicoEAV0Candidate>& candidates() const { return mCandidates; }
+
+  /// Number of pairs tested, passing the preselection and stored (all events)
+  Long64_t numberOfPairs() const                        { return mNPairs; }
+  Long64_t numberOfPreselectedPairs() const             { return mNPreselectedPairs; }
+  Long64_t numberOfCandidates() const                   { return mNCandidates; }
+
+ private:
+
+  /// Preselected daughter track
+  struct Daughter {
+    Int_t index;
+    StPicoPhysicalHelix helix;
+    /// Centre and radius of the helix circle in the xy-plane
+    Double_t xCenter;
+    Double_t yCenter;
+    Double_t radius;
+    /// DCA to the primary vertex
+    Float_t dca;
+  };
+
+  /// Analytic preselection of the pair: xy circles and z at the crossing
+  Bool_t IsPairPreselected(const Daughter& pos, const Daughter& neg) const;
+  /// Full pair DCA, topological cuts and masses. Returns true when the
+  /// candidate is kept
+  Bool_t MakeCandidate(const Daughter& pos, const Daughter& neg,
+                       const TVector3& pVtx, Double_t bField,
+                       StPicoEAV0Candidate& v0) const;
+
+  /// Cuts
+  Float_t mDaughterPtMin;
+  Int_t   mDaughterNHitsFitMin;
+  Float_t mDaughterDcaMin;
+  Float_t mDcaDaughtersMax;
+  Float_t mDecayLengthMin;
+  Float_t mCosPointingMin;
+  Float_t mDcaToPVMax;
+  Float_t mMassK0s[2];
+  Float_t mMassLambda[2];
+  Float_t mPreselectionZTolerance;
+
+  /// Helices of all tracks of the event (DCA to the primary vertex)
+  StPicoHelixBatch mHelixBatch;
+  /// Track index of each helix in mHelixBatch
+  std::vector<Int_t> mBatchTrackIndex;
+  /// Preselected positive and negative daughters
+  std::vector<Daughter> mPositive;
+  std::vector<Daughter> mNegative;
+  /// Candidates of the current event
+  std::vector<StPicoEAV0Candidate> mCandidates;
+
+  /// Counters
+  Long64_t mNPairs;
+  Long64_t mNPreselectedPairs;
+  Long64_t mNCandidates;
+};
+
+#endif // StPicoEAV0Finder_h
@@ -0,0 +1,279 @@
+// C++ headers
+#include <cmath>
+
+// StPicoEASkimmer headers
+#include "StPicoEAVertexFitter.h"
+
+// StPicoEvent headers
+#include "StPicoEvent/StPicoDst.h"
+#include "StPicoEvent/StPicoTrack.h"
+#include "StPicoEvent/StPicoTrackCovArrays.h"
+
+// ROOT headers
+#include "TMath.h"
+
+//________________
+StPicoEAVertexFitter::StPicoEAVertexFitter() :
+  mTrackNHitsFitMin(15), mTrackDcaMax(3.), mTukeyChi2Cut(9.),
+  mMaxIterations(10), mTolerance(1e-3),
+  mVertex(), mChi2(0), mNdf(0), mSumOfWeights(0), mNIterations(0),
+  mIsFitted(false), mSlotOfTrack(),
+  mOx(), mOy(), mOz(), mAx(), mAy(), mBx(), mBy(),
+  mW00(), mW01(), mW11(), mC00(), mC01(), mC11(), mWeight() {
+  for (Int_t i=0; i<6; i++) {
+    mVertexCov[i] = 0.;
+    mSumA[i] = 0.;
+  }
+  for (Int_t i=0; i<3; i++) {
+    mSumB[i] = 0.;
+  }
+}
+
+//________________
+StPicoEAVertexFitter::~StPicoEAVertexFitter() {
+  /* empty */
+}
+
+//________________
+Bool_t StPicoEAVertexFitter::fit(StPicoDst *dst, const StPicoTrackCovArrays& cov,
+                                 const TVector3& startVertex) {
+
+  mIsFitted = false;
+  mVertex = startVertex;
+  mChi2 = 0;
+  mNdf = 0;
+  mSumOfWeights = 0;
+  mNIterations = 0;
+
+  mOx.clear(); mOy.clear(); mOz.clear();
+  mAx.clear(); mAy.clear(); mBx.clear(); mBy.clear();
+  mW00.clear(); mW01.clear(); mW11.clear();
+  mC00.clear(); mC01.clear(); mC11.clear();
+  mWeight.clear();
+
+  const Int_t nTracks = dst->numberOfTracks();
+  mSlotOfTrack.assign(nTracks, -1);
+  if ( cov.size() != nTracks ) return false;
+
+  // Gather the primary tracks with a covariance matrix into the slots
+  const Float_t *sImpImp = cov.cov(0);
+  const Float_t *sZImp = cov.cov(1);
+  const Float_t *sZZ = cov.cov(2);
+  for (Int_t iTrk=0; iTrk<nTracks; iTrk++) {
+    StPicoTrack *track = dst->track(iTrk);
+    if ( !track ) continue;
+    if ( !track->isPrimary() ) continue;
+    if ( !cov.isGood(iTrk) ) continue;
+    if ( track->nHitsFit() < mTrackNHitsFitMin ) continue;
+
+    TVector3 origin = track->origin();
+    if ( (origin - startVertex).Mag() > mTrackDcaMax ) continue;
+
+    Double_t c00 = sImpImp[iTrk];
+    Double_t c01 = sZImp[iTrk];
+    Double_t c11 = sZZ[iTrk];
+    Double_t det = c00 * c11 - c01 * c01;
+    if ( c00 <= 0. || c11 <= 0. || det <= 0. ) continue;
+
+    TVector3 mom = track->gMom();
+    Double_t pt = mom.Perp();
+    if ( pt <= 0. ) continue;
+    Double_t cosPhi = mom.X() / pt;
+    Double_t sinPhi = mom.Y() / pt;
+    Double_t tanLambda = mom.Z() / pt;
+
+    mSlotOfTrack[iTrk] = mOx.size();
+    mOx.push_back( origin.X() );
+    mOy.push_back( origin.Y() );
+    mOz.push_back( origin.Z() );
+    mAx.push_back( -sinPhi );
+    mAy.push_back( cosPhi );
+    mBx.push_back( -tanLambda * cosPhi );
+    mBy.push_back( -tanLambda * sinPhi );
+    mW00.push_back( c11 / det );
+    mW01.push_back( -c01 / det );
+    mW11.push_back( c00 / det );
+    mC00.push_back( c00 );
+    mC01.push_back( c01 );
+    mC11.push_back( c11 );
+    mWeight.push_back( 1. );
+  } //for (Int_t iTrk=0; iTrk<nTracks; iTrk++)
+
+  const Int_t nSlots = mOx.size();
+  if ( nSlots < 2 ) return false;
+
+  // Iterative reweighted least squares
+  Double_t vx = startVertex.X();
+  Double_t vy = startVertex.Y();
+  Double_t vz = startVertex.Z();
+  Double_t a[6], b[3], aInv[6];
+  for (Int_t iIter=0; iIter<mMaxIterations; iIter++) {
+    mNIterations = iIter + 1;
+
+    // Tukey weights from the residuals to the current vertex
+    Double_t chi2 = 0.;
+    Double_t sumW = 0.;
+    for (Int_t i=0; i<nSlots; i++) {
+      Double_t dx = mOx[i] - vx;
+      Double_t dy = mOy[i] - vy;
+      Double_t dz = mOz[i] - vz;
+      Double_t rImp = mAx[i] * dx + mAy[i] * dy;
+      Double_t rZ = mBx[i] * dx + mBy[i] * dy + dz;
+      Double_t trackChi2 = rImp * ( mW00[i] * rImp + mW01[i] * rZ ) +
+                           rZ * ( mW01[i] * rImp + mW11[i] * rZ );
+      Double_t w = 0.;
+      if ( trackChi2 < mTukeyChi2Cut ) {
+        w = 1. - trackChi2 / mTukeyChi2Cut;
+        w *= w;
+      }
+      mWeight[i] = w;
+      chi2 += w * trackChi2;
+      sumW += w;
+    }
+    mChi2 = chi2;
+    mSumOfWeights = sumW;
+    if ( sumW <= 0. ) return false;
+
+    // Normal equations
+    for (Int_t k=0; k<6; k++) a[k] = 0.;
+    for (Int_t k=0; k<3; k++) b[k] = 0.;
+    for (Int_t i=0; i<nSlots; i++) {
+      if ( mWeight[i] <= 0. ) continue;
+      AddTrackTerm(i, mWeight[i], a, b);
+    }
+    if ( !InvertSym3(a, aInv) ) return false;
+
+    Double_t newX = aInv[0] * b[0] + aInv[1] * b[1] + aInv[3] * b[2];
+    Double_t newY = aInv[1] * b[0] + aInv[2] * b[1] + aInv[4] * b[2];
+    Double_t newZ = aInv[3] * b[0] + aInv[4] * b[1] + aInv[5] * b[2];
+    Double_t shift2 = ( (newX - vx) * (newX - vx) + (newY - vy) * (newY - vy) +
+                        (newZ - vz) * (newZ - vz) );
+    vx = newX;
+    vy = newY;
+    vz = newZ;
+    for (Int_t k=0; k<6; k++) {
+      mSumA[k] = a[k];
+      mVertexCov[k] = aInv[k];
+    }
+    for (Int_t k=0; k<3; k++) mSumB[k] = b[k];
+
+    if ( shift2 < mTolerance * mTolerance ) break;
+  } //for (Int_t iIter=0; iIter<mMaxIterations; iIter++)
+
+  mVertex.SetXYZ(vx, vy, vz);
+  mNdf = 2. * mSumOfWeights - 3.;
+  mIsFitted = true;
+  return true;
+}
+
+//________________
+TVector3 StPicoEAVertexFitter::vertexError() const {
+  if ( !mIsFitted ) return TVector3(0., 0., 0.);
+  return TVector3( TMath::Sqrt( TMath::Max(mVertexCov[0], 0.) ),
+                   TMath::Sqrt( TMath::Max(mVertexCov[2], 0.) ),
+                   TMath::Sqrt( TMath::Max(mVertexCov[5], 0.) ) );
+}
+
+//________________
+Bool_t StPicoEAVertexFitter::unbiasedDca(Int_t iTrk, Float_t& dcaXY, Float_t& dcaZ,
+                                         Float_t& significance) const {
+
+  if ( !mIsFitted ) return false;
+  if ( iTrk < 0 || iTrk >= (Int_t)mSlotOfTrack.size() ) return false;
+  Int_t iSlot = mSlotOfTrack[iTrk];
+  if ( iSlot < 0 ) return false;
+
+  // Vertex without the track: remove its term from the normal equations
+  Double_t a[6], b[3], aInv[6];
+  for (Int_t k=0; k<6; k++) a[k] = mSumA[k];
+  for (Int_t k=0; k<3; k++) b[k] = mSumB[k];
+  if ( mWeight[iSlot] > 0. ) {
+    AddTrackTerm(iSlot, -mWeight[iSlot], a, b);
+  }
+  if ( !InvertSym3(a, aInv) ) return false;
+  Double_t vx = aInv[0] * b[0] + aInv[1] * b[1] + aInv[3] * b[2];
+  Double_t vy = aInv[1] * b[0] + aInv[2] * b[1] + aInv[4] * b[2];
+  Double_t vz = aInv[3] * b[0] + aInv[4] * b[1] + aInv[5] * b[2];
+
+  // Residuals of the track to that vertex
+  Double_t dx = mOx[iSlot] - vx;
+  Double_t dy = mOy[iSlot] - vy;
+  Double_t dz = mOz[iSlot] - vz;
+  Double_t rImp = mAx[iSlot] * dx + mAy[iSlot] * dy;
+  Double_t rZ = mBx[iSlot] * dx + mBy[iSlot] * dy + dz;
+  dcaXY = rImp;
+  dcaZ = rZ;
+
+  // Covariance of the residuals: track (imp, z) plus J V J^T of the vertex
+  Double_t aVec[3] = { mAx[iSlot], mAy[iSlot], 0. };
+  Double_t bVec[3] = { mBx[iSlot], mBy[iSlot], 1. };
+  Double_t vA[3], vB[3];
+  vA[0] = aInv[0] * aVec[0] + aInv[1] * aVec[1] + aInv[3] * aVec[2];
+  vA[1] = aInv[1] * aVec[0] + aInv[2] * aVec[1] + aInv[4] * aVec[2];
+  vA[2] = aInv[3] * aVec[0] + aInv[4] * aVec[1] + aInv[5] * aVec[2];
+  vB[0] = aInv[0] * bVec[0] + aInv[1] * bVec[1] + aInv[3] * bVec[2];
+  vB[1] = aInv[1] * bVec[0] + aInv[2] * bVec[1] + aInv[4] * bVec[2];
+  vB[2] = aInv[3] * bVec[0] + aInv[4] * bVec[1] + aInv[5] * bVec[2];
+  Double_t c00 = mC00[iSlot] + aVec[0] * vA[0] + aVec[1] * vA[1] + aVec[2] * vA[2];
+  Double_t c01 = mC01[iSlot] + aVec[0] * vB[0] + aVec[1] * vB[1] + aVec[2] * vB[2];
+  Double_t c11 = mC11[iSlot] + bVec[0] * vB[0] + bVec[1] * vB[1] + bVec[2] * vB[2];
+  Double_t det = c00 * c11 - c01 * c01;
+  if ( det <= 0. ) return false;
+
+  Double_t chi2 = ( c11 * rImp * rImp - 2. * c01 * rImp * rZ + c00 * rZ * rZ ) / det;
+  significance = TMath::Sqrt( TMath::Max(chi2, 0.) );
+  return true;
+}
+
+//________________
+void StPicoEAVertexFitter::AddTrackTerm(Int_t i, Double_t w, Double_t a[6], Double_t b[3]) const {
+
+  // H = J^T W J with the rows of J: (ax, ay, 0) and (bx, by, 1)
+  Double_t ax = mAx[i], ay = mAy[i];
+  Double_t bx = mBx[i], by = mBy[i];
+  Double_t w00 = w * mW00[i];
+  Double_t w01 = w * mW01[i];
+  Double_t w11 = w * mW11[i];
+  // W J
+  Double_t ux = w00 * ax + w01 * bx;
+  Double_t uy = w00 * ay + w01 * by;
+  Double_t uz = w01;
+  Double_t tx = w01 * ax + w11 * bx;
+  Double_t ty = w01 * ay + w11 * by;
+  Double_t tz = w11;
+  Double_t hxx = ax * ux + bx * tx;
+  Double_t hxy = ax * uy + bx * ty;
+  Double_t hyy = ay * uy + by * ty;
+  Double_t hxz = ax * uz + bx * tz;
+  Double_t hyz = ay * uz + by * tz;
+  Double_t hzz = tz;
+  a[0] += hxx;
+  a[1] += hxy;
+  a[2] += hyy;
+  a[3] += hxz;
+  a[4] += hyz;
+  a[5] += hzz;
+  Double_t ox = mOx[i], oy = mOy[i], oz = mOz[i];
+  b[0] += hxx * ox + hxy * oy + hxz * oz;
+  b[1] += hxy * ox + hyy * oy + hyz * oz;
+  b[2] += hxz * ox + hyz * oy + hzz * oz;
+}
+
+//________________
+Bool_t StPicoEAVertexFitter::InvertSym3(const Double_t a[6], Double_t inv[6]) {
+
+  // a = (xx, xy, yy, xz, yz, zz)
+  Double_t c00 = a[2] * a[5] - a[4] * a[4];
+  Double_t c01 = a[3] * a[4] - a[1] * a[5];
+  Double_t c02 = a[1] * a[4] - a[2] * a[3];
+  Double_t det = a[0] * c00 + a[1] * c01 + a[3] * c02;
+  if ( det == 0. || !std::isfinite(det) ) return false;
+  Double_t invDet = 1. / det;
+  inv[0] = c00 * invDet;
+  inv[1] = c01 * invDet;
+  inv[2] = ( a[0] * a[5] - a[3] * a[3] ) * invDet;
+  inv[3] = c02 * invDet;
+  inv[4] = ( a[1] * a[3] - a[0] * a[4] ) * invDet;
+  inv[5] = ( a[0] * a[2] - a[1] * a[1] ) * invDet;
+  return true;
+}
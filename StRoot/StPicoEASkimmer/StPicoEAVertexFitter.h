@@ -0,0 +1,107 @@
+#ifndef StPicoEAVertexFitter_h
+#define StPicoEAVertexFitter_h
+
+// C++ headers
+#include <vector>
+
+// ROOT headers
+#include "Rtypes.h"
+#include "TVector3.h"
+
+//
+// Forward declarations
+//
+
+class StPicoDst;
+class StPicoTrackCovArrays;
+
+//________________
+/// Primary vertex refit from the primary tracks and their covariance
+/// matrices (StPicoTrackCovMatrix), with unbiased DCAs and DCA
+/// significances of single tracks.
+///
+/// Every track is linearized at its origin (the point of DCA to the
+/// reconstructed vertex) and contributes two measurements with the 2x2
+/// covariance of (imp, z): the transverse impact parameter and z at the
+/// point of closest approach. The weighted least-squares vertex is found
+/// with Tukey weights (outliers are down-weighted) in a few iterations,
+/// which stop as soon as the vertex moves less than the tolerance. The
+/// fit is a sum of per-track terms, so the vertex without a given track
+/// (for its unbiased DCA) is obtained by subtracting the track term
+/// instead of refitting.
+class StPicoEAVertexFitter {
+
+ public:
+  /// Constructor
+  StPicoEAVertexFitter();
+  /// Destructor
+  virtual ~StPicoEAVertexFitter();
+
+  /// Track selection for the fit
+  void setTrackNHitsFitMin(const int& nHits)            { mTrackNHitsFitMin = nHits; }
+  void setTrackDcaMax(const float& dca)                 { mTrackDcaMax = dca; }
+  /// Tukey cut on the track chi2 (2 degrees of freedom)
+  void setTukeyChi2Cut(const float& chi2)               { mTukeyChi2Cut = chi2; }
+  /// Maximal number of iterations and the convergence tolerance (cm)
+  void setMaxIterations(const int& nIter)               { mMaxIterations = nIter; }
+  void setTolerance(const float& tolerance)             { mTolerance = tolerance; }
+
+  /// Fit the vertex of the current event, starting from the given vertex.
+  /// Returns false when fewer than 2 tracks are usable
+  Bool_t fit(StPicoDst *dst, const StPicoTrackCovArrays& cov, const TVector3& startVertex);
+
+  /// Fitted vertex and its errors
+  const TVector3& vertex() const                        { return mVertex; }
+  TVector3 vertexError() const;
+  /// Chi2 and the number of degrees of freedom (2 per track - 3)
+  Float_t chi2() const                                  { return mChi2; }
+  Float_t ndf() const                                   { return mNdf; }
+  /// Sum of the Tukey weights of the tracks
+  Float_t sumOfWeights() const                          { return mSumOfWeights; }
+  /// Number of iterations done
+  Int_t   numberOfIterations() const                    { return mNIterations; }
+
+  /// DCA of the track (index in the picoDst) to the vertex refitted
+  /// without the track: signed transverse and longitudinal DCA and the
+  /// significance including the vertex error. Returns false when the
+  /// track has no covariance matrix or the vertex cannot be refitted
+  Bool_t unbiasedDca(Int_t iTrk, Float_t& dcaXY, Float_t& dcaZ, Float_t& significance) const;
+
+ private:
+
+  /// Inverse of the packed symmetric 3x3 matrix (xx, xy, yy, xz, yz, zz)
+  static Bool_t InvertSym3(const Double_t a[6], Double_t inv[6]);
+  /// Add w * J^T W J and w * J^T W J o of the fit slot to the sums
+  void AddTrackTerm(Int_t iSlot, Double_t w, Double_t a[6], Double_t b[3]) const;
+
+  /// Track cuts
+  Int_t   mTrackNHitsFitMin;
+  Float_t mTrackDcaMax;
+  Float_t mTukeyChi2Cut;
+  Int_t   mMaxIterations;
+  Float_t mTolerance;
+
+  /// Result
+  TVector3 mVertex;
+  Double_t mVertexCov[6];
+  Double_t mSumA[6];
+  Double_t mSumB[3];
+  Float_t  mChi2;
+  Float_t  mNdf;
+  Float_t  mSumOfWeights;
+  Int_t    mNIterations;
+  Bool_t   mIsFitted;
+
+  /// Fit slot of each picoDst track (-1: not used)
+  std::vector<Int_t> mSlotOfTrack;
+  /// Per-slot arrays: origin, measurement directions (rows of J: a for
+  /// the impact parameter, b for z with b_z = 1), the inverse covariance
+  /// (w00, w01, w11), the covariance (c00, c01, c11) and the Tukey weight
+  std::vector<Double_t> mOx, mOy, mOz;
+  std::vector<Double_t> mAx, mAy, mBx, mBy;
+  std::vector<Double_t> mW00, mW01, mW11;
+  std::vector<Double_t> mC00, mC01, mC11;
+  std::vector<Double_t> mWeight;
+};
+
+#endif // StPicoEAVertexFitter_h
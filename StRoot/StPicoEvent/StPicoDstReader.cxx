@@ -8,6 +8,11 @@
 #include <iostream>
 #include <fstream>
 #include <assert.h>
+#include <limits>
+#include <algorithm>
+#include <utility>
+#include <cctype>
+#include <cstdlib>
 
 // PicoDst headers
 #include "StPicoMessMgr.h"
@@ -34,9 +39,11 @@
 #include "StPicoMcTrack.h"
 #include "StPicoArrays.h"
 #include "StPicoDst.h"
+#include "StPicoEventIndex.h"
 
 // ROOT headers
 #include "TRegexp.h"
+#include "TSystem.h"
 
 ClassImp(StPicoDstReader)
 
@@ -49,6 +56,17 @@ StPicoDstReader::StPicoDstReader(const Char_t* inFileName) :
   createArrays();
   std::fill_n(mStatusArrays, sizeof(mStatusArrays) / sizeof(mStatusArrays[0]), 1);
   mInputFileName = inFileName;
+  mResumeFileName = "";
+  mEventIndex = NULL;
+  mFileShard = 0;
+  mNFileShards = 1;
+  mEntryShard = 0;
+  mNEntryShards = 1;
+  mRangeFirst = 0;
+  mRangeLast = -1;
+  mSortByRun = false;
+  mFirstEntry = 0;
+  mLastEntry = -1;
 }
 
 //_________________
@@ -59,6 +77,9 @@ StPicoDstReader::~StPicoDstReader() {
   if(mPicoDst) {
     delete mPicoDst;
   }
+  if(mEventIndex) {
+    delete mEventIndex;
+  }
 }
 
 //_________________
@@ -160,7 +181,112 @@ void StPicoDstReader::Init() {
     mChain = new TChain("PicoDst");
   }
 
+  if ( mNFileShards < 1 || mFileShard < 0 || mFileShard >= mNFileShards ||
+       mNEntryShards < 1 || mEntryShard < 0 || mEntryShard >= mNEntryShards ) {
+    LOG_ERROR << "Wrong shard: file shard " << mFileShard << " of " << mNFileShards
+              << ", entry shard " << mEntryShard << " of " << mNEntryShards
+              << ". No input is read" << endm;
+    // No chain: the caller sees that there is no input
+    delete mChain;
+    mChain = NULL;
+    return;
+  }
+
+  // Resume: the tree offsets of the checkpoint are only valid in the file
+  // order of the attempt that wrote the state file
+  std::string sortByRun;
+  if ( !mResumeFileName.IsNull() &&
+       readStateFileValue( mResumeFileName.Data(), "sortByRun", sortByRun ) ) {
+    Bool_t isSorted = ( std::atoi( sortByRun.c_str() ) != 0 );
+    if ( isSorted != mSortByRun ) {
+      LOG_WARN << " Input files are read " << ( isSorted ? "ordered by run" : "in the input order" )
+               << " as in the state file " << mResumeFileName << endm;
+      mSortByRun = isSorted;
+    }
+  }
+
+  std::vector<std::string> files;
+  Bool_t isList = false;
+  collectInputFiles(files, isList);
+
+  // Runs in one piece: the run-level state of the analysis changes once per run
+  if ( mSortByRun ) {
+    std::vector< std::pair<Int_t, size_t> > order( files.size() );
+    for (size_t iFile=0; iFile<files.size(); iFile++) {
+      Int_t run = runNumberFromFileName( files[iFile] );
+      order[iFile] = std::make_pair( ( run < 0 ) ? std::numeric_limits<Int_t>::max() : run, iFile );
+    }
+    std::sort( order.begin(), order.end() );
+    std::vector<std::string> sorted( files.size() );
+    for (size_t iFile=0; iFile<files.size(); iFile++) {
+      sorted[iFile] = files[ order[iFile].second ];
+    }
+    files.swap( sorted );
+    LOG_INFO << " Input files are ordered by run number" << endm;
+  }
+
+  // Contiguous block of files of this shard
+  size_t iFirstFile = files.size() * mFileShard / mNFileShards;
+  size_t iLastFile = files.size() * (mFileShard + 1) / mNFileShards;
+  if ( mNFileShards > 1 ) {
+    LOG_INFO << " File shard " << mFileShard << " of " << mNFileShards << ": files "
+             << iFirstFile << "-" << iLastFile << " of " << files.size() << endm;
+  }
+
+  Int_t nFile = 0;
+  for (size_t iFile=iFirstFile; iFile<iLastFile; iFile++) {
+    const std::string& file = files[iFile];
+    if ( isList ) {
+      // Files from a list are checked before they are added
+      TFile* ftmp = TFile::Open(file.c_str());
+      if(ftmp && !ftmp->IsZombie() && ftmp->GetNkeys()) {
+        LOG_INFO << " Read in picoDst file " << file << endm;
+        mChain->Add(file.c_str());
+        ++nFile;
+      } //if(ftmp && !ftmp->IsZombie() && ftmp->GetNkeys())
+
+      if (ftmp) {
+        ftmp->Close();
+      } //if (ftmp)
+    }
+    else {
+      mChain->Add(file.c_str());
+      ++nFile;
+    }
+  } //for (size_t iFile=iFirstFile; iFile<iLastFile; iFile++)
+
+  if ( nFile == 0 ) {
+    LOG_WARN << " No good input file to read ... " << endm;
+  }
+  else {
+    LOG_INFO << " Total " << nFile << " files have been read in. " << endm;
+  }
+
+  if(mChain) {
+    setBranchAddresses(mChain);
+    mChain->SetCacheSize(50e6);
+    mChain->AddBranchToCache("*");
+    mPicoDst->set(mPicoArrays);
+
+    applyEntryRange();
+
+    // A state file of another input would duplicate or drop events
+    if ( !mResumeFileName.IsNull() && !resumeFromStateFile() ) {
+      LOG_ERROR << " State file " << mResumeFileName << " does not match the input. "
+                << "No input is read" << endm;
+      delete mChain;
+      mChain = NULL;
+    }
+  }
+}
+
+//_________________
+void StPicoDstReader::collectInputFiles(std::vector<std::string>& files, Bool_t& isList) {
+
   std::string const dirFile = mInputFileName.Data();
+  isList = false;
+  FileStat_t stat;
+  Bool_t isDirectory = ( gSystem->GetPathInfo(dirFile.c_str(), stat) == 0 && R_ISDIR(stat.fMode) );
 
   if( dirFile.find(".list") != std::string::npos ||
       dirFile.find(".lis") != std::string::npos ) {
@@ -171,46 +297,275 @@ void StPicoDstReader::Init() {
       LOG_ERROR << "ERROR: Cannot open list file " << dirFile << endm;
     }
 
-    Int_t nFile = 0;
+    isList = true;
     std::string file;
     size_t pos;
     while(getline(inputStream, file)) {
       // NOTE: our external formatters may pass "file NumEvents"
       //       Take only the first part
-      //cout << "DEBUG found " <<  file << endl;
       pos = file.find_first_of(" ");
       if (pos != std::string::npos ) file.erase(pos,file.length()-pos);
-      //cout << "DEBUG found [" <<  file << "]" << endl;
 
       if(file.find(".picoDst.root") != std::string::npos) {
-        TFile* ftmp = TFile::Open(file.c_str());
-        if(ftmp && !ftmp->IsZombie() && ftmp->GetNkeys()) {
-          LOG_INFO << " Read in picoDst file " << file << endm;
-          mChain->Add(file.c_str());
-          ++nFile;
-        } //if(ftmp && !ftmp->IsZombie() && ftmp->GetNkeys())
-
-        if (ftmp) {
-	        ftmp->Close();
-        } //if (ftmp)
-      } //if(file.find(".picoDst.root") != std::string::npos)
+        files.push_back(file);
+      }
     } //while (getline(inputStream, file))
-
-    LOG_INFO << " Total " << nFile << " files have been read in. " << endm;
   } //if(dirFile.find(".list") != std::string::npos || dirFile.find(".lis" != string::npos))
+  else if( isDirectory || dirFile.find_first_of("*?[") != std::string::npos ) {
+
+    // Directory: all picoDst files in it; wildcard: the matching files of
+    // its directory (the directory part cannot have wildcards)
+    TString dirName = dirFile.c_str();
+    TString pattern = "*.picoDst.root";
+    if ( !isDirectory ) {
+      pattern = gSystem->BaseName(dirFile.c_str());
+      dirName = gSystem->DirName(dirFile.c_str());
+    }
+
+    void *dir = gSystem->OpenDirectory(dirName);
+    if ( !dir ) {
+      LOG_ERROR << "ERROR: Cannot open directory " << dirName << endm;
+      return;
+    }
+    TRegexp re(pattern, kTRUE);
+    const Char_t *entry;
+    while ( (entry = gSystem->GetDirEntry(dir)) ) {
+      TString name = entry;
+      Ssiz_t len;
+      if ( !name.EndsWith(".picoDst.root") ) continue;
+      if ( re.Index(name, &len) != 0 || len != name.Length() ) continue;
+      files.push_back( (dirName + "/" + name).Data() );
+    }
+    gSystem->FreeDirectory(dir);
+
+    // Directory order is arbitrary: sort for the same shards everywhere
+    std::sort(files.begin(), files.end());
+    LOG_INFO << " Found " << files.size() << " picoDst files matching "
+             << dirName << "/" << pattern << endm;
+  }
   else if(dirFile.find(".picoDst.root") != std::string::npos) {
-    mChain->Add(dirFile.c_str());
+    files.push_back(dirFile);
   }
-  else {
-    LOG_WARN << " No good input file to read ... " << endm;
+}
+
+//_________________
+UInt_t StPicoDstReader::fileListHash(TChain *chain) {
+
+  if ( !chain ) return 0;
+  TString names;
+  TObjArray *fileElements = chain->GetListOfFiles();
+  for (Int_t iFile=0; iFile<fileElements->GetEntriesFast(); iFile++) {
+    names += fileElements->At(iFile)->GetTitle();
+    names += "\n";
   }
+  return names.Hash();
+}
 
-  if(mChain) {
-    setBranchAddresses(mChain);
-    mChain->SetCacheSize(50e6);
-    mChain->AddBranchToCache("*");
-    mPicoDst->set(mPicoArrays);
+//_________________
+Bool_t StPicoDstReader::readStateFileValue(const Char_t* stateFileName, const std::string& key,
+                                           std::string& value) {
+
+  std::ifstream stateStream( stateFileName );
+  std::string name;
+  while ( stateStream >> name ) {
+    if ( name == key ) {
+      stateStream >> value;
+      return !stateStream.fail();
+    }
+    stateStream.ignore( std::numeric_limits<std::streamsize>::max(), '\n' );
   }
+  return false;
+}
+
+//_________________
+Int_t StPicoDstReader::runNumberFromFileName(const std::string& fileName) {
+
+  // The run number is the digits right before "_raw_" (st_<stream>_<run>_raw_<n>)
+  std::string::size_type slash = fileName.find_last_of('/');
+  std::string baseName = ( slash == std::string::npos ) ? fileName : fileName.substr( slash + 1 );
+  std::string::size_type pos = baseName.find("_raw_");
+  if ( pos == std::string::npos ) return -1;
+
+  std::string::size_type begin = pos;
+  while ( begin > 0 && std::isdigit( (unsigned char)baseName[begin - 1] ) ) begin--;
+  if ( begin == pos || pos - begin > 9 ) return -1;
+  return std::atoi( baseName.substr( begin, pos - begin ).c_str() );
+}
+
+//_________________
+void StPicoDstReader::applyEntryRange() {
+
+  mFirstEntry = 0;
+  mLastEntry = -1;
+  if ( mRangeFirst <= 0 && mRangeLast < 0 && mNEntryShards == 1 ) return;
+
+  // Tree offsets of the chain are known only after all trees have been read
+  Long64_t nEntries = mChain->GetEntries();
+  Long64_t first = std::min( std::max( mRangeFirst, (Long64_t)0 ), nEntries );
+  Long64_t last = ( mRangeLast < 0 ) ? nEntries : std::min( mRangeLast, nEntries );
+  if ( last < first ) last = first;
+
+  mFirstEntry = first + (last - first) * mEntryShard / mNEntryShards;
+  mLastEntry = first + (last - first) * (mEntryShard + 1) / mNEntryShards;
+  mEventCounter = mFirstEntry;
+
+  LOG_INFO << " Read entries " << mFirstEntry << "-" << mLastEntry << " of " << nEntries
+           << " (entry shard " << mEntryShard << " of " << mNEntryShards << ")" << endm;
+  if ( mFirstEntry >= mLastEntry ) {
+    LOG_WARN << " Entry range is empty: no event to read ... " << endm;
+  }
+}
+
+//_________________
+Bool_t StPicoDstReader::setEventIndex(const Char_t* indexFileName) {
+
+  if (!mChain) {
+    LOG_ERROR << "setEventIndex: no input. Call Init first" << endm;
+    return false;
+  }
+
+  if (!mEventIndex) {
+    mEventIndex = new StPicoEventIndex();
+  }
+  if ( !mEventIndex->open(indexFileName) ) {
+    return false;
+  }
+
+  // Match the files of the index to the files of the chain: by the full
+  // name first, then by the base name (e.g. local copy vs xrootd path)
+  mChain->GetEntries(); // Tree offsets are needed to read by the local entry
+  TObjArray *fileElements = mChain->GetListOfFiles();
+  mIndexTreeNumbers.assign(mEventIndex->numberOfFiles(), -1);
+  UInt_t nMatched = 0;
+  for (UInt_t iFile=0; iFile<mEventIndex->numberOfFiles(); iFile++) {
+    TString indexName = mEventIndex->fileName(iFile).c_str();
+    for (Int_t iTree=0; iTree<fileElements->GetEntriesFast(); iTree++) {
+      TString chainName = fileElements->At(iTree)->GetTitle();
+      if ( chainName == indexName ||
+           TString(gSystem->BaseName(chainName)) == gSystem->BaseName(indexName) ) {
+        mIndexTreeNumbers[iFile] = iTree;
+        nMatched++;
+        break;
+      }
+    }
+  }
+
+  LOG_INFO << "Event index " << indexFileName << ": " << mEventIndex->numberOfRecords()
+           << " events, " << nMatched << " of " << mEventIndex->numberOfFiles()
+           << " files are in the input" << endm;
+  return true;
+}
+
+//_________________
+Bool_t StPicoDstReader::readPicoEvent(Int_t runId, Int_t eventId) {
+
+  if ( !mChain || !mEventIndex || !mEventIndex->isOpen() ) {
+    LOG_WARN << "readPicoEvent: no event index. Call setEventIndex first" << endm;
+    return false;
+  }
+
+  const StPicoEventIndexRecord *record = mEventIndex->find(runId, eventId);
+  if ( !record ) {
+    LOG_WARN << "Event " << eventId << " of run " << runId << " is not in the index" << endm;
+    return false;
+  }
+  Int_t iTree = mIndexTreeNumbers[ record->fileIndex ];
+  if ( iTree < 0 ) {
+    LOG_WARN << "File " << mEventIndex->fileName(record->fileIndex)
+             << " with event " << eventId << " of run " << runId << " is not in the input" << endm;
+    return false;
+  }
+
+  // Exactly this entry: no fallthrough to the next one on a read error
+  Long64_t entry = mChain->GetTreeOffset()[iTree] + record->entry;
+  if ( mLastEntry >= 0 && entry >= mLastEntry ) return false;
+  if ( mChain->GetEntry(entry) <= 0 ) {
+    LOG_WARN << "Cannot read entry " << entry << " with event " << eventId
+             << " of run " << runId << endm;
+    return false;
+  }
+
+  // A stale index or another order of the input gives another event
+  StPicoEvent *event = mPicoDst->event();
+  if ( !event || event->runId() != runId || event->eventId() != eventId ) {
+    LOG_WARN << "Entry " << entry << " does not hold event " << eventId << " of run "
+             << runId << ". The event index does not match the input" << endm;
+    return false;
+  }
+  mEventCounter = entry + 1;
+  return true;
+}
+
+//_________________
+Bool_t StPicoDstReader::resumeFromStateFile() {
+
+  std::ifstream stateStream( mResumeFileName.Data() );
+  if ( !stateStream ) {
+    LOG_INFO << "No state file " << mResumeFileName << " found. Start from the beginning" << endm;
+    return true;
+  }
+
+  std::string key, fileName;
+  Long64_t entry = -1;
+  Int_t isComplete = 0;
+  Long64_t inputHash = -1;
+  while ( stateStream >> key ) {
+    if ( key == "file" ) stateStream >> fileName;
+    else if ( key == "entry" ) stateStream >> entry;
+    else if ( key == "complete" ) stateStream >> isComplete;
+    else if ( key == "inputHash" ) stateStream >> inputHash;
+    else stateStream.ignore( std::numeric_limits<std::streamsize>::max(), '\n' );
+  }
+
+  // Tree offsets of the chain are known only after all trees have been read
+  Long64_t nEntries = mChain->GetEntries();
+  if ( isComplete ) {
+    LOG_INFO << "State file " << mResumeFileName << " marks the input as completed" << endm;
+    mEventCounter = ( mLastEntry >= 0 ) ? mLastEntry : nEntries;
+    return true;
+  }
+  if ( fileName.empty() || entry < 0 ) {
+    LOG_INFO << "No event was completed before the checkpoint. Start from the beginning" << endm;
+    return true;
+  }
+
+  // Same files in the same order as in the attempt that wrote the state
+  // file. Older state files have no hash: only the unsorted input is safe
+  if ( inputHash >= 0 && (UInt_t)inputHash != fileListHash(mChain) ) {
+    LOG_ERROR << "Input files or their order differ from the state file " << mResumeFileName << endm;
+    return false;
+  }
+  if ( inputHash < 0 && mSortByRun ) {
+    LOG_ERROR << "State file " << mResumeFileName << " has no input hash: "
+              << "cannot resume with the input ordered by run" << endm;
+    return false;
+  }
+
+  TObjArray *fileElements = mChain->GetListOfFiles();
+  for (Int_t iFile=0; iFile<fileElements->GetEntriesFast(); iFile++) {
+    if ( fileName != fileElements->At(iFile)->GetTitle() ) continue;
+    mEventCounter = std::max( mChain->GetTreeOffset()[iFile] + entry + 1, mFirstEntry );
+    LOG_INFO << "Resume from entry " << mEventCounter << " of " << nEntries
+             << " (file " << fileName << ", entry " << entry << ")" << endm;
+    return true;
+  }
+
+  LOG_ERROR << "File " << fileName << " from the state file " << mResumeFileName
+            << " is not in the input" << endm;
+  return false;
+}
+
+//_________________
+Bool_t StPicoDstReader::readEventBranch() {
+
+  if ( !mChain ) return false;
+  if ( mLastEntry >= 0 && mEventCounter >= mLastEntry ) return false;
+
+  Long64_t localEntry = mChain->LoadTree(mEventCounter);
+  if ( localEntry < 0 || !mChain->GetTree() ) return false;
+  TBranch *branch = mChain->GetTree()->GetBranch( StPicoArrays::picoArrayNames[StPicoArrays::Event] );
+  if ( !branch ) return false;
+  return ( branch->GetEntry(localEntry) > 0 );
 }
 
 //_________________
@@ -224,6 +579,12 @@ Bool_t StPicoDstReader::readPicoEvent(Long64_t iEvent __attribute__((unused)) )
     return mStatusRead;
   }
 
+  // End of the entry range
+  if ( mLastEntry >= 0 && mEventCounter >= mLastEntry ) {
+    mStatusRead = false;
+    return mStatusRead;
+  }
+
   Int_t bytes = mChain->GetEntry(mEventCounter++);
   Int_t nCycles = 0;
   while( bytes <= 0) {
@@ -15,6 +15,10 @@
 #ifndef StPicoDstReader_h
 #define StPicoDstReader_h
 
+// C++ headers
+#include <vector>
+#include <string>
+
 // ROOT headers
 #include "TChain.h"
 #include "TTree.h"
@@ -27,13 +31,16 @@
 #include "StPicoEvent.h"
 #include "StPicoArrays.h"
 
+class StPicoEventIndex;
+
 //_________________
 class StPicoDstReader : public TObject {
 
  public:
 
-  /// Constructor that takes either picoDst file or file that
-  /// contains a list of picoDst.root files
+  /// Constructor that takes either picoDst file, file that contains
+  /// a list of picoDst.root files, a directory with picoDst.root files
+  /// or a wildcard pattern of picoDst.root files (e.g. /data/st_*.picoDst.root)
   StPicoDstReader(const Char_t* inFileName);
   /// Destructor
   ~StPicoDstReader();
@@ -48,12 +55,74 @@ class StPicoDstReader : public TObject {
   /// Set enable/disable branch matching when reading picoDst
   void SetStatus(const Char_t* branchNameRegex, Int_t enable);
 
+  /// Resume from a checkpoint state file (as written by StPicoEASkimmer).
+  /// The file contains "file <name>", "entry <local entry>" and
+  /// "complete <0|1>" lines: reading starts right after the last completed
+  /// entry of that file. The files are read in the order given by its
+  /// "sortByRun <0|1>" line (overrides setSortByRun). When the file is not
+  /// in the input or "inputHash" (fileListHash) differs, Init leaves the
+  /// reader without a chain. Must be called before Init
+  void setResumeFile(const Char_t* stateFileName) { mResumeFileName = stateFileName; }
+  /// Number of the next chain entry to be read
+  Long64_t eventCounter() const { return mEventCounter; }
+
+  /// Read only the files of shard iShard of nShards: the input files are
+  /// split into nShards contiguous blocks of (almost) equal number of files.
+  /// Must be called before Init. With an invalid file or entry shard Init
+  /// leaves the reader without a chain
+  void setFileShard(Int_t iShard, Int_t nShards)
+  { mFileShard = iShard; mNFileShards = nShards; }
+  /// Read only the entries of shard iShard of nShards: the chain entries
+  /// (or the entry range) are split into nShards contiguous ranges of equal
+  /// number of entries. Must be called before Init
+  void setEntryShard(Int_t iShard, Int_t nShards)
+  { mEntryShard = iShard; mNEntryShards = nShards; }
+  /// Read only the chain entries [first, last); last < 0 means till the
+  /// end of the chain. Must be called before Init
+  void setEntryRange(Long64_t first, Long64_t last)
+  { mRangeFirst = first; mRangeLast = last; }
+  /// Order the input files by run number (stable, files without a run
+  /// number last), so that the events of a run are read together.
+  /// Applied before the file shards. Must be called before Init
+  void setSortByRun(Bool_t sort)                        { mSortByRun = sort; }
+  /// Input files are ordered by run (after Init: as actually read)
+  Bool_t sortByRun() const                              { return mSortByRun; }
+  /// Hash of the file names of the chain in their order (0 without chain)
+  static UInt_t fileListHash(TChain *chain);
+  /// Run number from a file name as st_physics_<run>_raw_<n>.picoDst.root
+  /// (-1 if the name has no run number)
+  static Int_t runNumberFromFileName(const std::string& fileName);
+  /// First chain entry to be read
+  Long64_t firstEntry() const { return mFirstEntry; }
+  /// Chain entry after the last one to be read
+  Long64_t lastEntry() const
+  { return ( mLastEntry >= 0 || !mChain ) ? mLastEntry : mChain->GetEntries(); }
+  /// Number of entries to be read (all entries of the chain without shards
+  /// and entry ranges)
+  Long64_t numberOfEntries() const { return lastEntry() - mFirstEntry; }
+
+  /// Use an event index file (see StPicoEventIndex) built for the same
+  /// input to enable readPicoEvent(runId, eventId). Must be called after Init
+  Bool_t setEventIndex(const Char_t* indexFileName);
+  /// Read the event with the given run and event IDs. Returns false if the
+  /// event is not in the index, its file is not in the chain, it is after
+  /// the entry range, its entry cannot be read or holds another event
+  /// (Event branch must be on). The next sequential read continues after
+  /// this event
+  Bool_t readPicoEvent(Int_t runId, Int_t eventId);
+
   /// Calls openRead()
   void Init();
   /// Read next event in the chain
   Bool_t readPicoEvent(Long64_t iEvent);
   /// Read next event in the chain
   Bool_t ReadPicoEvent(Long64_t iEvent) { return readPicoEvent(iEvent); }
+  /// Read only the Event branch of the next entry, e.g. to reject the
+  /// event before the other branches are read. The entry stays the next
+  /// one: read it with readPicoEvent or skip it with skipEntry
+  Bool_t readEventBranch();
+  /// Skip the next entry
+  void skipEntry()                                      { mEventCounter++; }
   /// Close files and finilize
   void Finish();
 
@@ -71,6 +140,38 @@ class StPicoDstReader : public TObject {
   void clearArrays();
   /// Set adresses of picoArrays and their statuses (enable/disable) to chain
   void setBranchAddresses(TChain *chain);
+  /// Value of the key in the state file (false if the key is not there)
+  static Bool_t readStateFileValue(const Char_t* stateFileName, const std::string& key,
+                                   std::string& value);
+  /// Move the event counter past the entries completed in the state file.
+  /// Returns false when the state file does not match the input
+  Bool_t resumeFromStateFile();
+  /// Input file names: lines of the list, files of the directory or
+  /// files matching the wildcard pattern
+  void collectInputFiles(std::vector<std::string>& files, Bool_t& isList);
+  /// Set the first and the last entry from the entry range and shard
+  void applyEntryRange();
+
+  /// Name of the checkpoint state file to resume from
+  TString mResumeFileName;
+
+  /// File and entry shards and the requested entry range
+  Int_t    mFileShard;
+  Int_t    mNFileShards;
+  Int_t    mEntryShard;
+  Int_t    mNEntryShards;
+  Long64_t mRangeFirst;
+  Long64_t mRangeLast;
+  /// Order the input files by run number
+  Bool_t   mSortByRun;
+  /// Entries to read: [mFirstEntry, mLastEntry), mLastEntry < 0 - all
+  Long64_t mFirstEntry;
+  Long64_t mLastEntry;
+
+  /// Event index used by readPicoEvent(runId, eventId)
+  StPicoEventIndex *mEventIndex; //!
+  /// Tree number in the chain of each file of the event index (-1 if absent)
+  std::vector<Int_t> mIndexTreeNumbers;
 
   /// Pointer to the input/output picoDst structure
   StPicoDst *mPicoDst;
@@ -80,7 +181,7 @@ class StPicoDstReader : public TObject {
   TTree *mTree;
 
   /// Event counter
-  Int_t mEventCounter;
+  Long64_t mEventCounter;
 
   /// Pointers to pico arrays
   TClonesArray *mPicoArrays[StPicoArrays::NAllPicoArrays];
@@ -0,0 +1,317 @@
+// C++ headers
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+
+// POSIX headers
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// ROOT headers
+#include "TChain.h"
+#include "TChainElement.h"
+#include "TObjArray.h"
+
+// PicoDst headers
+#include "StPicoMessMgr.h"
+#include "StPicoDst.h"
+#include "StPicoEvent.h"
+#include "StPicoDstReader.h"
+#include "StPicoEventIndex.h"
+
+namespace {
+
+  /// Magic string at the beginning of the index file
+  const Char_t kIndexMagic[8] = { 'P', 'I', 'C', 'O', 'E', 'I', 'D', 'X' };
+  /// Version of the index layout
+  const UInt_t kIndexVersion = 1;
+
+  /// Header of the index file (32 bytes)
+  struct IndexHeader {
+    Char_t   magic[8];
+    UInt_t   version;
+    UInt_t   nFiles;
+    Long64_t nRecords;
+    Long64_t fileTableOffset;
+  };
+
+  /// Records are ordered by run and then by event
+  bool recordLess(const StPicoEventIndexRecord& a, const StPicoEventIndexRecord& b) {
+    if ( a.runId != b.runId ) return a.runId < b.runId;
+    return a.eventId < b.eventId;
+  }
+
+} // namespace
+
+//_________________
+StPicoEventIndex::StPicoEventIndex() : mMapAddress(NULL), mMapSize(0),
+                                       mRecords(NULL), mNRecords(0), mFileNames() {
+  /* empty */
+}
+
+//_________________
+StPicoEventIndex::~StPicoEventIndex() {
+  close();
+}
+
+//_________________
+std::vector<std::string> StPicoEventIndex::inputFiles(const Char_t* inFileName) {
+
+  std::vector<std::string> files;
+  std::string const dirFile = inFileName;
+
+  if( dirFile.find(".list") != std::string::npos ||
+      dirFile.find(".lis") != std::string::npos ) {
+    std::ifstream inputStream( dirFile.c_str() );
+    if(!inputStream) {
+      LOG_ERROR << "StPicoEventIndex: cannot open list file " << dirFile << endm;
+    }
+    std::string file;
+    while(getline(inputStream, file)) {
+      // Take only the first part of "file NumEvents"
+      size_t pos = file.find_first_of(" ");
+      if (pos != std::string::npos ) file.erase(pos, file.length()-pos);
+      if (file.find(".root") != std::string::npos) files.push_back(file);
+    }
+  }
+  else {
+    files.push_back(dirFile);
+  }
+  return files;
+}
+
+//_________________
+Bool_t StPicoEventIndex::buildFromPicoDst(const Char_t* inFileName, const Char_t* indexFileName) {
+
+  // Read only the event branch
+  StPicoDstReader *picoReader = new StPicoDstReader(inFileName);
+  picoReader->Init();
+  if ( !picoReader->chain() || picoReader->chain()->GetEntries() <= 0 ) {
+    LOG_ERROR << "StPicoEventIndex: no events in " << inFileName << endm;
+    delete picoReader;
+    return false;
+  }
+  picoReader->SetStatus("*", 0);
+  picoReader->SetStatus("Event*", 1);
+
+  TChain *chain = picoReader->chain();
+  std::vector<std::string> fileNames;
+  TObjArray *fileElements = chain->GetListOfFiles();
+  for (Int_t iFile=0; iFile<fileElements->GetEntriesFast(); iFile++) {
+    fileNames.push_back( fileElements->At(iFile)->GetTitle() );
+  }
+
+  Long64_t nEntries = chain->GetEntries();
+  std::vector<StPicoEventIndexRecord> records;
+  records.reserve(nEntries);
+  for (Long64_t iEntry=0; iEntry<nEntries; iEntry++) {
+    if ( !picoReader->readPicoEvent(iEntry) ) break;
+    StPicoEvent *event = picoReader->picoDst()->event();
+    if ( !event ) continue;
+    StPicoEventIndexRecord record;
+    record.runId = event->runId();
+    record.eventId = event->eventId();
+    record.fileIndex = chain->GetTreeNumber();
+    record.reserved = 0;
+    record.entry = chain->GetTree()->GetReadEntry();
+    records.push_back(record);
+  }
+  picoReader->Finish();
+  delete picoReader;
+
+  return write(indexFileName, records, fileNames);
+}
+
+//_________________
+Bool_t StPicoEventIndex::buildFromTree(const Char_t* inFileName, const Char_t* indexFileName,
+                                       const Char_t* treeName,
+                                       const Char_t* runIdBranch,
+                                       const Char_t* eventIdBranch) {
+
+  TChain *chain = new TChain(treeName);
+  std::vector<std::string> fileNames = inputFiles(inFileName);
+  for (unsigned int iFile=0; iFile<fileNames.size(); iFile++) {
+    chain->Add( fileNames[iFile].c_str() );
+  }
+  if ( chain->GetEntries() <= 0 ) {
+    LOG_ERROR << "StPicoEventIndex: no entries in " << treeName << " of " << inFileName << endm;
+    delete chain;
+    return false;
+  }
+  if ( !chain->GetBranch(runIdBranch) || !chain->GetBranch(eventIdBranch) ) {
+    LOG_ERROR << "StPicoEventIndex: branches " << runIdBranch << " and " << eventIdBranch
+              << " are needed in " << treeName << endm;
+    delete chain;
+    return false;
+  }
+
+  Int_t runId = 0;
+  Int_t eventId = 0;
+  chain->SetBranchStatus("*", 0);
+  chain->SetBranchStatus(runIdBranch, 1);
+  chain->SetBranchStatus(eventIdBranch, 1);
+  chain->SetBranchAddress(runIdBranch, &runId);
+  chain->SetBranchAddress(eventIdBranch, &eventId);
+
+  // File table follows the chain elements, so the tree number is the file index
+  fileNames.clear();
+  TObjArray *fileElements = chain->GetListOfFiles();
+  for (Int_t iFile=0; iFile<fileElements->GetEntriesFast(); iFile++) {
+    fileNames.push_back( fileElements->At(iFile)->GetTitle() );
+  }
+
+  Long64_t nEntries = chain->GetEntries();
+  std::vector<StPicoEventIndexRecord> records;
+  records.reserve(nEntries);
+  for (Long64_t iEntry=0; iEntry<nEntries; iEntry++) {
+    Long64_t localEntry = chain->LoadTree(iEntry);
+    if ( localEntry < 0 ) break;
+    chain->GetEntry(iEntry);
+    StPicoEventIndexRecord record;
+    record.runId = runId;
+    record.eventId = eventId;
+    record.fileIndex = chain->GetTreeNumber();
+    record.reserved = 0;
+    record.entry = localEntry;
+    records.push_back(record);
+  }
+  delete chain;
+
+  return write(indexFileName, records, fileNames);
+}
+
+//_________________
+Bool_t StPicoEventIndex::write(const Char_t* indexFileName,
+                               std::vector<StPicoEventIndexRecord>& records,
+                               const std::vector<std::string>& fileNames) {
+
+  std::stable_sort(records.begin(), records.end(), recordLess);
+
+  // Duplicates are kept (first one is found), but reported
+  Long64_t nDuplicates = 0;
+  for (size_t iRec=1; iRec<records.size(); iRec++) {
+    if ( !recordLess(records[iRec-1], records[iRec]) ) nDuplicates++;
+  }
+  if ( nDuplicates > 0 ) {
+    LOG_WARN << "StPicoEventIndex: " << nDuplicates << " duplicated (runId, eventId) pairs" << endm;
+  }
+
+  std::ofstream out(indexFileName, std::ios::binary | std::ios::trunc);
+  if ( !out ) {
+    LOG_ERROR << "StPicoEventIndex: cannot write " << indexFileName << endm;
+    return false;
+  }
+
+  IndexHeader header;
+  std::memcpy(header.magic, kIndexMagic, sizeof(header.magic));
+  header.version = kIndexVersion;
+  header.nFiles = fileNames.size();
+  header.nRecords = records.size();
+  header.fileTableOffset = sizeof(IndexHeader) + records.size() * sizeof(StPicoEventIndexRecord);
+  out.write( reinterpret_cast<const char*>(&header), sizeof(IndexHeader) );
+  if ( !records.empty() ) {
+    out.write( reinterpret_cast<const char*>(&records[0]),
+               records.size() * sizeof(StPicoEventIndexRecord) );
+  }
+  for (size_t iFile=0; iFile<fileNames.size(); iFile++) {
+    UInt_t length = fileNames[iFile].size();
+    out.write( reinterpret_cast<const char*>(&length), sizeof(UInt_t) );
+    out.write( fileNames[iFile].data(), length );
+  }
+  out.close();
+
+  LOG_INFO << "StPicoEventIndex: " << records.size() << " events from " << fileNames.size()
+           << " files have been written to " << indexFileName << endm;
+  return true;
+}
+
+//_________________
+Bool_t StPicoEventIndex::open(const Char_t* indexFileName) {
+
+  close();
+
+  int fd = ::open(indexFileName, O_RDONLY);
+  if ( fd < 0 ) {
+    LOG_ERROR << "StPicoEventIndex: cannot open " << indexFileName << endm;
+    return false;
+  }
+  struct stat fileStat;
+  if ( fstat(fd, &fileStat) != 0 || fileStat.st_size < (off_t)sizeof(IndexHeader) ) {
+    LOG_ERROR << "StPicoEventIndex: " << indexFileName << " is not an event index" << endm;
+    ::close(fd);
+    return false;
+  }
+
+  void *address = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping stays valid after the descriptor is closed
+  ::close(fd);
+  if ( address == MAP_FAILED ) {
+    LOG_ERROR << "StPicoEventIndex: cannot map " << indexFileName << endm;
+    return false;
+  }
+  mMapAddress = static_cast<Char_t*>(address);
+  mMapSize = fileStat.st_size;
+
+  const IndexHeader *header = reinterpret_cast<const IndexHeader*>(mMapAddress);
+  if ( std::memcmp(header->magic, kIndexMagic, sizeof(kIndexMagic)) != 0 ||
+       header->version != kIndexVersion ||
+       header->fileTableOffset > mMapSize ||
+       (Long64_t)(sizeof(IndexHeader) + header->nRecords * sizeof(StPicoEventIndexRecord)) >
+       header->fileTableOffset ) {
+    LOG_ERROR << "StPicoEventIndex: " << indexFileName
+              << " is not an event index or has an unknown version" << endm;
+    close();
+    return false;
+  }
+
+  mRecords = reinterpret_cast<const StPicoEventIndexRecord*>(mMapAddress + sizeof(IndexHeader));
+  mNRecords = header->nRecords;
+
+  // File table is small: copy it
+  const Char_t *position = mMapAddress + header->fileTableOffset;
+  const Char_t *end = mMapAddress + mMapSize;
+  for (UInt_t iFile=0; iFile<header->nFiles; iFile++) {
+    UInt_t length = 0;
+    if ( position + sizeof(UInt_t) > end ) break;
+    std::memcpy(&length, position, sizeof(UInt_t));
+    position += sizeof(UInt_t);
+    if ( position + length > end ) break;
+    mFileNames.push_back( std::string(position, length) );
+    position += length;
+  }
+  if ( mFileNames.size() != header->nFiles ) {
+    LOG_ERROR << "StPicoEventIndex: file table of " << indexFileName << " is truncated" << endm;
+    close();
+    return false;
+  }
+
+  return true;
+}
+
+//_________________
+void StPicoEventIndex::close() {
+  if ( mMapAddress ) {
+    munmap(mMapAddress, mMapSize);
+  }
+  mMapAddress = NULL;
+  mMapSize = 0;
+  mRecords = NULL;
+  mNRecords = 0;
+  mFileNames.clear();
+}
+
+//_________________
+const StPicoEventIndexRecord *StPicoEventIndex::find(Int_t runId, Int_t eventId) const {
+
+  if ( !mRecords ) return NULL;
+
+  StPicoEventIndexRecord key;
+  key.runId = runId;
+  key.eventId = eventId;
+  const StPicoEventIndexRecord *last = mRecords + mNRecords;
+  const StPicoEventIndexRecord *it = std::lower_bound(mRecords, last, key, recordLess);
+  if ( it == last || it->runId != runId || it->eventId != eventId ) return NULL;
+  return it;
+}
@@ -0,0 +1,99 @@
+/**
+ * \class StPicoEventIndex
+ * \brief Sorted (runId, eventId) -> (file, entry) lookup table
+ *
+ * The index is a binary sidecar file that is built once for a picoDst
+ * file list or for skim (EATree) outputs and then memory-mapped for
+ * O(log n) lookups. Layout of the file (native byte order):
+ *  - header: magic "PICOEIDX", version, number of files, number of records
+ *  - records: StPicoEventIndexRecord sorted by (runId, eventId)
+ *  - file table: for each file the length of its name and the name
+ *
+ * The entry stored in a record is local to its file, so the index stays
+ * valid however the files are chained. Use StPicoDstReader::setEventIndex
+ * and StPicoDstReader::readPicoEvent(runId, eventId) to fetch an event,
+ * or macros/picoEventIndex.C to build and query the index.
+ */
+
+#ifndef StPicoEventIndex_h
+#define StPicoEventIndex_h
+
+// C++ headers
+#include <vector>
+#include <string>
+
+// ROOT headers
+#include "Rtypes.h"
+
+//_________________
+/// One event of the index (POD, 24 bytes)
+struct StPicoEventIndexRecord {
+  /// Run ID
+  Int_t    runId;
+  /// Event ID
+  Int_t    eventId;
+  /// Index of the file in the file table
+  Int_t    fileIndex;
+  /// Padding to keep the record 8-byte aligned
+  Int_t    reserved;
+  /// Entry of the event in its file
+  Long64_t entry;
+};
+
+//_________________
+class StPicoEventIndex {
+
+ public:
+  /// Default constructor
+  StPicoEventIndex();
+  /// Destructor (unmaps the index)
+  virtual ~StPicoEventIndex();
+
+  /// Build the index for name.picoDst.root or a name.lis(t) of picoDst files
+  static Bool_t buildFromPicoDst(const Char_t* inFileName, const Char_t* indexFileName);
+  /// Build the index for a flat tree (e.g. EATree of StPicoEASkimmer) from
+  /// a single .root file or a name.lis(t) of files. The run and event IDs
+  /// are read from the Int_t branches runIdBranch and eventIdBranch
+  static Bool_t buildFromTree(const Char_t* inFileName, const Char_t* indexFileName,
+                              const Char_t* treeName = "EATree",
+                              const Char_t* runIdBranch = "runId",
+                              const Char_t* eventIdBranch = "eventID");
+
+  /// Memory-map an index file
+  Bool_t open(const Char_t* indexFileName);
+  /// Unmap the index
+  void close();
+  /// Index has been opened
+  Bool_t isOpen() const                  { return mRecords != 0; }
+
+  /// Find the event. Returns NULL if it is not in the index
+  const StPicoEventIndexRecord *find(Int_t runId, Int_t eventId) const;
+  /// Number of events in the index
+  Long64_t numberOfRecords() const       { return mNRecords; }
+  /// Number of files in the index
+  UInt_t numberOfFiles() const           { return mFileNames.size(); }
+  /// Name of the file with the given index
+  const std::string& fileName(Int_t fileIndex) const { return mFileNames.at(fileIndex); }
+
+ private:
+
+  /// Sort records and write them together with the file table
+  static Bool_t write(const Char_t* indexFileName,
+                      std::vector<StPicoEventIndexRecord>& records,
+                      const std::vector<std::string>& fileNames);
+  /// Read file names from name.lis(t) or return the single file name
+  static std::vector<std::string> inputFiles(const Char_t* inFileName);
+
+  /// Start of the mapped file
+  Char_t *mMapAddress;
+  /// Size of the mapped file
+  Long64_t mMapSize;
+  /// Pointer to the first (sorted) record inside the mapped file
+  const StPicoEventIndexRecord *mRecords;
+  /// Number of records
+  Long64_t mNRecords;
+  /// File table
+  std::vector<std::string> mFileNames;
+};
+
+#endif
@@ -56,9 +56,41 @@ StPicoHelix::StPicoHelix(const StPicoHelix &h) {
   mSinPhase = h.mSinPhase;
 }
 
+//_________________
+StPicoHelix::StPicoHelix(const StPicoLiteHelix &h) {
+  mSingularity = ( h.isStraight != 0 );
+  mOrigin.SetXYZ(h.originX, h.originY, h.originZ);
+  mDipAngle = h.dipAngle;
+  mCurvature = h.curvature;
+  mPhase = h.phase;
+  mH = h.h;
+  mCosDipAngle = h.cosDipAngle;
+  mSinDipAngle = h.sinDipAngle;
+  mCosPhase = h.cosPhase;
+  mSinPhase = h.sinPhase;
+}
+
 //_________________
 StPicoHelix::~StPicoHelix() { /* noop */ };
 
+//_________________
+StPicoLiteHelix StPicoHelix::liteHelix() const {
+  StPicoLiteHelix h;
+  h.originX = mOrigin.X();
+  h.originY = mOrigin.Y();
+  h.originZ = mOrigin.Z();
+  h.curvature = mCurvature;
+  h.dipAngle = mDipAngle;
+  h.phase = mPhase;
+  h.cosDipAngle = mCosDipAngle;
+  h.sinDipAngle = mSinDipAngle;
+  h.cosPhase = mCosPhase;
+  h.sinPhase = mSinPhase;
+  h.h = mH;
+  h.isStraight = mSingularity ? 1 : 0;
+  return h;
+}
+
 //_________________
 void StPicoHelix::setParameters(Double_t c, Double_t dip, Double_t phase,
 				const TVector3& o, Int_t h) {
@@ -26,6 +26,7 @@
 #else
 #include "StarClassLibrary/SystemOfUnits.h"
 #endif
+#include "StPicoLiteHelix.h"
 
 // Declare C++ namespaces
 #if !defined(ST_NO_NAMESPACES)
@@ -49,6 +50,9 @@ class StPicoHelix {
   /// Copy constructor
   StPicoHelix(const StPicoHelix&);
 
+  /// Constructor from the lightweight helix
+  StPicoHelix(const StPicoLiteHelix&);
+
   // Assignment operator (will use the one, provided by compiler)
   //StPicoHelix& operator=(const StPicoHelix&);
   
@@ -71,6 +75,9 @@ class StPicoHelix {
   /// Return origin of the helix = starting point
   const TVector3& origin() const;
 
+  /// Lightweight (POD) copy of the helix
+  StPicoLiteHelix liteHelix() const;
+
   /// Set helix parameters
   void setParameters(Double_t c, Double_t dip, Double_t phase, const TVector3& o, Int_t h);
 
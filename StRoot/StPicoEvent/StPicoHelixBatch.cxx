@@ -0,0 +1,367 @@
+//
+// StPicoHelixBatch computes helix path lengths and DCAs for many helices at once
+//
+
+// C++ headers
+#include <cmath>
+
+// PicoDst headers
+#include "StPicoHelix.h"
+#include "StPicoHelixBatch.h"
+#include "StPicoLiteHelix.h"
+#include "StPicoTrack.h"
+#ifdef _VANILLA_ROOT_
+#include "PhysicalConstants.h"
+#include "SystemOfUnits.h"
+#else
+#include "StarClassLibrary/PhysicalConstants.h"
+#include "StarClassLibrary/SystemOfUnits.h"
+#endif
+
+// Precision and maximal number of iterations of the Newton method
+// (the same as in StPicoHelix)
+namespace {
+  const Double_t kMaxPrecisionNeeded = units::micrometer;
+  const Int_t    kMaxPointIterations = 100;
+  const Int_t    kMaxPlaneIterations = 20;
+  const Double_t kNoCylinderSolution = 999999999.;
+}
+
+const Int_t StPicoHelixBatch::kBlockSize;
+
+//_________________
+StPicoHelixBatch::StPicoHelixBatch() {
+  /* no-op */
+}
+
+//_________________
+StPicoHelixBatch::~StPicoHelixBatch() {
+  /* no-op */
+}
+
+//_________________
+void StPicoHelixBatch::clear() {
+  mCurvature.clear();
+  mDipAngle.clear();
+  mPhase.clear();
+  mH.clear();
+  mStraight.clear();
+  mOriginX.clear();
+  mOriginY.clear();
+  mOriginZ.clear();
+  mCosDipAngle.clear();
+  mSinDipAngle.clear();
+  mCosPhase.clear();
+  mSinPhase.clear();
+}
+
+//_________________
+void StPicoHelixBatch::reserve(Int_t n) {
+  mCurvature.reserve(n);
+  mDipAngle.reserve(n);
+  mPhase.reserve(n);
+  mH.reserve(n);
+  mStraight.reserve(n);
+  mOriginX.reserve(n);
+  mOriginY.reserve(n);
+  mOriginZ.reserve(n);
+  mCosDipAngle.reserve(n);
+  mSinDipAngle.reserve(n);
+  mCosPhase.reserve(n);
+  mSinPhase.reserve(n);
+}
+
+//_________________
+Int_t StPicoHelixBatch::add(const TVector3& p, const TVector3& o, Double_t B, Double_t q) {
+
+  // Same parametrization as StPicoPhysicalHelix(p, o, B*kilogauss, q)
+  StPicoLiteHelix helix;
+  helix.set( p, o, B * units::kilogauss, q );
+
+  // Straight lines keep a unit curvature so that the helix formulas,
+  // which are evaluated for all entries, stay finite
+  mCurvature.push_back( helix.isStraight ? 1. : helix.curvature );
+  mDipAngle.push_back( helix.dipAngle );
+  mPhase.push_back( helix.phase );
+  mH.push_back( helix.h );
+  mStraight.push_back( helix.isStraight ? 1. : 0. );
+  mOriginX.push_back( helix.originX );
+  mOriginY.push_back( helix.originY );
+  mOriginZ.push_back( helix.originZ );
+  mCosDipAngle.push_back( helix.cosDipAngle );
+  mSinDipAngle.push_back( helix.sinDipAngle );
+  mCosPhase.push_back( helix.cosPhase );
+  mSinPhase.push_back( helix.sinPhase );
+  return size() - 1;
+}
+
+//_________________
+Int_t StPicoHelixBatch::add(const StPicoTrack& track, Float_t B) {
+  return add( track.gMom(), track.origin(), B, static_cast<float>( track.charge() ) );
+}
+
+//_________________
+void StPicoHelixBatch::pathLength(const TVector3& p, std::vector<Double_t>& s) const {
+
+  const Int_t n = size();
+  s.resize(n);
+  if ( n == 0 ) return;
+
+  const Double_t px = p.x(), py = p.y(), pz = p.z();
+  const Double_t *c = &mCurvature[0], *h = &mH[0], *straight = &mStraight[0];
+  const Double_t *phase = &mPhase[0];
+  const Double_t *ox = &mOriginX[0], *oy = &mOriginY[0], *oz = &mOriginZ[0];
+  const Double_t *cDip = &mCosDipAngle[0], *sDip = &mSinDipAngle[0];
+  const Double_t *cPh = &mCosPhase[0], *sPh = &mSinPhase[0];
+  Double_t *sOut = &s[0];
+
+  // Start values: analytic solution for the straight lines,
+  // DCA in the xy-plane for the helices
+  for (Int_t i=0; i<n; i++) {
+    Double_t dx = px - ox[i];
+    Double_t dy = py - oy[i];
+    Double_t dz = pz - oz[i];
+    Double_t sLine = cDip[i] * ( cPh[i] * dy - sPh[i] * dx ) + sDip[i] * dz;
+    Double_t sXY = atan2( dy * cPh[i] - dx * sPh[i],
+                          1. / c[i] + dx * cPh[i] + dy * sPh[i] ) / ( h[i] * c[i] * cDip[i] );
+    sOut[i] = ( straight[i] > 0. ) ? sLine : sXY;
+  }
+
+  // Newton's method in lockstep for the blocks of helices. A helix is
+  // frozen once its step is below the precision, as in StPicoHelix
+  Double_t active[kBlockSize];
+  for (Int_t iFirst=0; iFirst<n; iFirst+=kBlockSize) {
+    const Int_t nInBlock = ( n - iFirst < kBlockSize ) ? n - iFirst : kBlockSize;
+    for (Int_t j=0; j<nInBlock; j++) {
+      active[j] = 1. - straight[iFirst + j];
+    }
+
+    for (Int_t iIter=0; iIter<kMaxPointIterations; iIter++) {
+      Double_t nActive = 0.;
+      for (Int_t j=0; j<nInBlock; j++) {
+        const Int_t i = iFirst + j;
+        Double_t dx = px - ox[i];
+        Double_t dy = py - oy[i];
+        Double_t dz = pz - oz[i];
+        Double_t cd2 = cDip[i] * cDip[i];
+        Double_t t34 = c[i] * cd2;
+        Double_t t41 = sDip[i] * sDip[i];
+        Double_t t6  = phase[i] + sOut[i] * h[i] * c[i] * cDip[i];
+        Double_t t7  = cos(t6);
+        Double_t t11 = dx - ( t7 - cPh[i] ) / c[i];
+        Double_t t12 = sin(t6);
+        Double_t t19 = dy - ( t12 - sPh[i] ) / c[i];
+        Double_t shift = ( t11 * t12 * h[i] * cDip[i] - t19 * t7 * h[i] * cDip[i] -
+                           ( dz - sOut[i] * sDip[i] ) * sDip[i] ) /
+          ( t12 * t12 * cd2 + t11 * t7 * t34 + t7 * t7 * cd2 + t19 * t12 * t34 + t41 );
+        shift *= active[j];
+        sOut[i] -= shift;
+        active[j] = ( ::fabs(shift) < kMaxPrecisionNeeded ) ? 0. : active[j];
+        nActive += active[j];
+      } //for (Int_t j=0; j<nInBlock; j++)
+      if ( nActive == 0. ) break;
+    } //for (Int_t iIter=0; iIter<kMaxPointIterations; iIter++)
+  } //for (Int_t iFirst=0; iFirst<n; iFirst+=kBlockSize)
+}
+
+//_________________
+void StPicoHelixBatch::distance(const TVector3& p, std::vector<Double_t>& s,
+                                std::vector<Double_t>& dca) const {
+
+  pathLength(p, s);
+
+  std::vector<Double_t> x, y, z;
+  at(s, x, y, z);
+
+  const Int_t n = size();
+  dca.resize(n);
+  for (Int_t i=0; i<n; i++) {
+    Double_t dx = x[i] - p.x();
+    Double_t dy = y[i] - p.y();
+    Double_t dz = z[i] - p.z();
+    dca[i] = ::sqrt( dx * dx + dy * dy + dz * dz );
+  }
+}
+
+//_________________
+void StPicoHelixBatch::distance(const TVector3& p, std::vector<Double_t>& dca) const {
+  std::vector<Double_t> s;
+  distance(p, s, dca);
+}
+
+//_________________
+void StPicoHelixBatch::pathLength(const TVector3& r, const TVector3& n,
+                                  std::vector<Double_t>& s) const {
+
+  const Int_t nHelices = size();
+  s.resize(nHelices);
+  if ( nHelices == 0 ) return;
+
+  const Double_t nx = n.x(), ny = n.y(), nz = n.z();
+  const Double_t *c = &mCurvature[0], *h = &mH[0], *straight = &mStraight[0];
+  const Double_t *phase = &mPhase[0];
+  const Double_t *ox = &mOriginX[0], *oy = &mOriginY[0], *oz = &mOriginZ[0];
+  const Double_t *cDip = &mCosDipAngle[0], *sDip = &mSinDipAngle[0];
+  const Double_t *cPh = &mCosPhase[0], *sPh = &mSinPhase[0];
+  Double_t *sOut = &s[0];
+
+  // Straight lines: analytic solution. Helices start at s = 0
+  for (Int_t i=0; i<nHelices; i++) {
+    Double_t rn = ( r.x() - ox[i] ) * nx + ( r.y() - oy[i] ) * ny + ( r.z() - oz[i] ) * nz;
+    Double_t t = nz * sDip[i] + ny * cDip[i] * cPh[i] - nx * cDip[i] * sPh[i];
+    Double_t sLine = ( t == 0 ) ? StPicoHelix::NoSolution : rn / t;
+    sOut[i] = ( straight[i] > 0. ) ? sLine : 0.;
+  }
+
+  //  (cos(angMax)-1)/angMax = 0.1
+  const Double_t angMax = 0.21;
+
+  // Damped Newton's method in lockstep for the blocks of helices
+  // (see StPicoHelix::pathLength(r, n))
+  Double_t active[kBlockSize];
+  for (Int_t iFirst=0; iFirst<nHelices; iFirst+=kBlockSize) {
+    const Int_t nInBlock = ( nHelices - iFirst < kBlockSize ) ? nHelices - iFirst : kBlockSize;
+    for (Int_t j=0; j<nInBlock; j++) {
+      active[j] = 1. - straight[iFirst + j];
+    }
+
+    for (Int_t iIter=0; iIter<kMaxPlaneIterations; iIter++) {
+      Double_t nActive = 0.;
+      for (Int_t j=0; j<nInBlock; j++) {
+        const Int_t i = iFirst + j;
+        Double_t A = c[i] * ( ( ox[i] - r.x() ) * nx + ( oy[i] - r.y() ) * ny +
+                              ( oz[i] - r.z() ) * nz ) - nx * cPh[i] - ny * sPh[i];
+        Double_t t = h[i] * c[i] * cDip[i];
+        Double_t u = nz * c[i] * sDip[i];
+        Double_t deltas = ::fabs( angMax / ( c[i] * cDip[i] ) );
+        Double_t a = t * sOut[i] + phase[i];
+        Double_t sina = sin(a);
+        Double_t cosa = cos(a);
+        Double_t f = A + nx * cosa + ny * sina + u * sOut[i];
+        Double_t fp = -nx * sina * t + ny * cosa * t + u;
+
+        // Limit too big steps
+        Double_t sgn = ( ( fp < 0. ) != ( f < 0. ) ) ? -1. : 1.;
+        Double_t limited = ( sgn < 0. ) ? -0.9 * deltas : deltas;
+        Double_t shift = ( ::fabs(fp) * deltas <= ::fabs(f) ) ? limited : f / fp;
+        shift *= active[j];
+        sOut[i] -= shift;
+        active[j] = ( ::fabs(shift) < kMaxPrecisionNeeded ) ? 0. : active[j];
+        nActive += active[j];
+      } //for (Int_t j=0; j<nInBlock; j++)
+      if ( nActive == 0. ) break;
+    } //for (Int_t iIter=0; iIter<kMaxPlaneIterations; iIter++)
+
+    // No convergence within the maximal number of iterations
+    for (Int_t j=0; j<nInBlock; j++) {
+      if ( active[j] > 0. ) sOut[iFirst + j] = StPicoHelix::NoSolution;
+    }
+  } //for (Int_t iFirst=0; iFirst<nHelices; iFirst+=kBlockSize)
+}
+
+//_________________
+void StPicoHelixBatch::pathLength(Double_t r, std::vector<Double_t>& s1,
+                                  std::vector<Double_t>& s2,
+                                  Double_t x, Double_t y) const {
+
+  const Int_t n = size();
+  s1.resize(n);
+  s2.resize(n);
+  if ( n == 0 ) return;
+
+  const Double_t *c = &mCurvature[0], *h = &mH[0], *straight = &mStraight[0];
+  const Double_t *phase = &mPhase[0];
+  const Double_t *ox = &mOriginX[0], *oy = &mOriginY[0];
+  const Double_t *cDip = &mCosDipAngle[0];
+  const Double_t *cPh = &mCosPhase[0], *sPh = &mSinPhase[0];
+  Double_t *first = &s1[0], *second = &s2[0];
+  const Double_t t14 = r * r;
+
+  // Closed-form solutions of StPicoHelix::pathLength(r) for both the
+  // straight lines and the helices, the valid one is selected per entry
+  for (Int_t i=0; i<n; i++) {
+    Double_t x0 = ox[i] - x;
+    Double_t y0 = oy[i] - y;
+    Double_t t8 = x0 * x0;
+    Double_t t11 = y0 * y0;
+    Double_t t13 = cPh[i] * cPh[i];
+    Double_t cd2 = cDip[i] * cDip[i];
+
+    // Straight line
+    Double_t lt1 = cDip[i] * ( x0 * sPh[i] - y0 * cPh[i] );
+    Double_t lt20 = -cd2 * ( 2.0 * x0 * sPh[i] * y0 * cPh[i] + t11 - t11 * t13 - t14 + t13 * t8 );
+    Double_t lSqrt = ::sqrt( ( lt20 < 0. ) ? 0. : lt20 );
+    Double_t lFirst = ( lt1 - lSqrt ) / cd2;
+    Double_t lSecond = ( lt1 + lSqrt ) / cd2;
+
+    // Helix
+    Double_t t1 = y0 * c[i];
+    Double_t t2 = sPh[i];
+    Double_t t3 = c[i] * c[i];
+    Double_t t4 = y0 * t2;
+    Double_t t5 = cPh[i];
+    Double_t t6 = x0 * t5;
+    Double_t t15 = t14 * c[i];
+    Double_t t17 = t8 * t8;
+    Double_t t19 = t11 * t11;
+    Double_t t21 = t11 * t3;
+    Double_t t32 = t14 * t14;
+    Double_t t35 = t14 * t3;
+    Double_t t38 = 8.0 * t4 * t6 - 4.0 * t1 * t2 * t8 - 4.0 * t11 * c[i] * t6 +
+      4.0 * t15 * t6 + t17 * t3 + t19 * t3 + 2.0 * t21 * t8 + 4.0 * t8 * t13 -
+      4.0 * t8 * x0 * c[i] * t5 - 4.0 * t11 * t13 -
+      4.0 * t11 * y0 * c[i] * t2 + 4.0 * t11 - 4.0 * t14 +
+      t32 * t3 + 4.0 * t15 * t4 - 2.0 * t35 * t11 - 2.0 * t35 * t8;
+    Double_t t40 = -t3 * t38;
+    Double_t hSqrt = ::sqrt( ( t40 < 0. ) ? 0. : t40 );
+    Double_t t43 = x0 * c[i];
+    Double_t t45 = 2.0 * t5 - t35 + t21 + 2.0 - 2.0 * t1 * t2 - 2.0 * t43 - 2.0 * t43 * t5 + t8 * t3;
+    Double_t t46 = h[i] * cDip[i] * c[i];
+    Double_t hFirst = ( -phase[i] + 2.0 * atan( ( -2.0 * t1 + 2.0 * t2 + hSqrt ) / t45 ) ) / t46;
+    Double_t hSecond = -( phase[i] + 2.0 * atan( ( 2.0 * t1 - 2.0 * t2 + hSqrt ) / t45 ) ) / t46;
+
+    // Solution can be off by +/- one period, select smallest
+    Double_t p = ::fabs( 2 * M_PI / t46 );
+    hFirst = ( ::fabs( hFirst - p ) < ::fabs( hFirst ) ) ? hFirst - p :
+      ( ::fabs( hFirst + p ) < ::fabs( hFirst ) ) ? hFirst + p : hFirst;
+    hSecond = ( ::fabs( hSecond - p ) < ::fabs( hSecond ) ) ? hSecond - p :
+      ( ::fabs( hSecond + p ) < ::fabs( hSecond ) ) ? hSecond + p : hSecond;
+
+    Bool_t isLine = ( straight[i] > 0. );
+    Bool_t noSolution = isLine ? ( lt20 < 0. ) : ( t40 < 0. );
+    Double_t a = isLine ? lFirst : hFirst;
+    Double_t b = isLine ? lSecond : hSecond;
+    first[i]  = noSolution ? kNoCylinderSolution : ( ( a > b ) ? b : a );
+    second[i] = noSolution ? kNoCylinderSolution : ( ( a > b ) ? a : b );
+  } //for (Int_t i=0; i<n; i++)
+}
+
+//_________________
+void StPicoHelixBatch::at(const std::vector<Double_t>& s, std::vector<Double_t>& x,
+                          std::vector<Double_t>& y, std::vector<Double_t>& z) const {
+
+  const Int_t n = size();
+  x.resize(n);
+  y.resize(n);
+  z.resize(n);
+  if ( n == 0 ) return;
+
+  const Double_t *c = &mCurvature[0], *h = &mH[0], *straight = &mStraight[0];
+  const Double_t *phase = &mPhase[0];
+  const Double_t *ox = &mOriginX[0], *oy = &mOriginY[0], *oz = &mOriginZ[0];
+  const Double_t *cDip = &mCosDipAngle[0], *sDip = &mSinDipAngle[0];
+  const Double_t *cPh = &mCosPhase[0], *sPh = &mSinPhase[0];
+  const Double_t *sIn = &s[0];
+  Double_t *xOut = &x[0], *yOut = &y[0], *zOut = &z[0];
+
+  for (Int_t i=0; i<n; i++) {
+    Double_t a = phase[i] + sIn[i] * h[i] * c[i] * cDip[i];
+    Double_t xHelix = ox[i] + ( cos(a) - cPh[i] ) / c[i];
+    Double_t yHelix = oy[i] + ( sin(a) - sPh[i] ) / c[i];
+    Double_t xLine = ox[i] - sIn[i] * cDip[i] * sPh[i];
+    Double_t yLine = oy[i] + sIn[i] * cDip[i] * cPh[i];
+    xOut[i] = ( straight[i] > 0. ) ? xLine : xHelix;
+    yOut[i] = ( straight[i] > 0. ) ? yLine : yHelix;
+    zOut[i] = oz[i] + sIn[i] * sDip[i];
+  }
+}
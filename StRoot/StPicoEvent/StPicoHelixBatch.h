@@ -0,0 +1,119 @@
+/**
+ * \class StPicoHelixBatch
+ * \brief Batch (structure-of-arrays) helix propagation
+ *
+ * Holds the parameters of many helices in contiguous arrays and computes
+ * the path length at the distance of closest approach to a point, to a
+ * plane or to a cylinder, the DCA and the positions for all of them in
+ * one call. The results are the same as the ones of StPicoHelix for the
+ * same helices (within the micrometer precision of the Newton method),
+ * but no StPicoPhysicalHelix/TVector3 objects are created per track and
+ * the loops run over plain arrays with no per-track branching, so that
+ * the compiler can vectorize them (-O3, and -ffast-math with a vector
+ * math library for sin/cos/atan2). The Newton iterations are done in
+ * lockstep for blocks of kBlockSize helices and stop when all of the
+ * helices in the block have converged.
+ *
+ * Helices are built from the global momentum, origin and charge of the
+ * tracks and the magnetic field in kilogauss, the same way as
+ * StPicoTrack::helix(B):
+ *
+ *   StPicoHelixBatch batch;
+ *   batch.reserve( dst->numberOfTracks() );
+ *   for (...) batch.add( *dst->track(iTrk), event->bField() );
+ *   batch.distance( event->primaryVertex(), dca );
+ */
+
+#ifndef StPicoHelixBatch_h
+#define StPicoHelixBatch_h
+
+// C++ headers
+#include <vector>
+
+// ROOT headers
+#include "Rtypes.h"
+#include "TVector3.h"
+
+// Forward declaration
+class StPicoTrack;
+
+//_________________
+class StPicoHelixBatch {
+
+ public:
+  /// Default constructor
+  StPicoHelixBatch();
+  /// Destructor
+  virtual ~StPicoHelixBatch();
+
+  /// Number of helices processed together by the Newton iterations
+  static const Int_t kBlockSize = 64;
+
+  /// Remove all helices
+  void clear();
+  /// Reserve space for n helices
+  void reserve(Int_t n);
+  /// Number of helices
+  Int_t size() const                  { return (Int_t)mCurvature.size(); }
+
+  /// Add a helix of a particle with momentum p (GeV/c), charge q at the
+  /// origin o (cm) in the field B (kilogauss). Returns its index
+  Int_t add(const TVector3& p, const TVector3& o, Double_t B, Double_t q);
+  /// Add the helix of the global track (same as StPicoTrack::helix(B))
+  Int_t add(const StPicoTrack& track, Float_t B);
+
+  /// Path lengths at the distance of closest approach to the point.
+  /// The start value is the DCA in the xy-plane, no scan over the periods
+  /// is done (same as StPicoHelix::pathLength(p, false))
+  void pathLength(const TVector3& p, std::vector<Double_t>& s) const;
+  /// Distances of closest approach to the point (path lengths are also returned)
+  void distance(const TVector3& p, std::vector<Double_t>& s,
+                std::vector<Double_t>& dca) const;
+  /// Distances of closest approach to the point
+  void distance(const TVector3& p, std::vector<Double_t>& dca) const;
+
+  /// Path lengths at the intersection with the plane through r with the
+  /// normal n (StPicoHelix::NoSolution when no intersection is found)
+  void pathLength(const TVector3& r, const TVector3& n, std::vector<Double_t>& s) const;
+
+  /// Path lengths at the two intersections with the cylinder of radius r
+  /// and axis along z through (x, y); first is the smaller one. Both are
+  /// 999999999. when there is no intersection
+  void pathLength(Double_t r, std::vector<Double_t>& s1, std::vector<Double_t>& s2,
+                  Double_t x = 0., Double_t y = 0.) const;
+
+  /// Positions at the path lengths s (one per helix)
+  void at(const std::vector<Double_t>& s, std::vector<Double_t>& x,
+          std::vector<Double_t>& y, std::vector<Double_t>& z) const;
+
+  /// Helix parameters (same meaning as in StPicoHelix)
+  Double_t curvature(Int_t i) const   { return mCurvature[i]; }
+  Double_t dipAngle(Int_t i) const    { return mDipAngle[i]; }
+  Double_t phase(Int_t i) const       { return mPhase[i]; }
+  Int_t    h(Int_t i) const           { return (Int_t)mH[i]; }
+  TVector3 origin(Int_t i) const      { return TVector3( mOriginX[i], mOriginY[i], mOriginZ[i] ); }
+
+ private:
+
+  /// Curvature = 1/R (1 for the straight lines, see mStraight)
+  std::vector<Double_t> mCurvature;
+  /// Dip angle
+  std::vector<Double_t> mDipAngle;
+  /// Phase
+  std::vector<Double_t> mPhase;
+  /// -sign(q*B) as a floating point number
+  std::vector<Double_t> mH;
+  /// 1 for the straight lines (B=0), 0 for the helices
+  std::vector<Double_t> mStraight;
+  /// Origin
+  std::vector<Double_t> mOriginX;
+  std::vector<Double_t> mOriginY;
+  std::vector<Double_t> mOriginZ;
+  /// Cos and sin of the dip angle and of the phase
+  std::vector<Double_t> mCosDipAngle;
+  std::vector<Double_t> mSinDipAngle;
+  std::vector<Double_t> mCosPhase;
+  std::vector<Double_t> mSinPhase;
+};
+
+#endif
@@ -0,0 +1,331 @@
+/**
+ * \class StPicoLiteHelix
+ * \brief Trivially copyable helix with the math of StPicoPhysicalHelix
+ *
+ * Plain value type (no TObject, no virtual functions, no TVector3 members)
+ * with the same parametrization and the same algorithms as StPicoHelix and
+ * StPicoPhysicalHelix: positions, path length at the DCA to a point and to
+ * the intersection with a plane, distance and momentum at a path length.
+ * It is meant for hot loops and for arrays of helices (it can be copied
+ * with memcpy and stored in std::vector without any construction cost).
+ * Use StPicoTrack::liteHelix(B) to build it from a track, and
+ * StPicoHelix::liteHelix() / StPicoPhysicalHelix(const StPicoLiteHelix&)
+ * to convert between the two representations.
+ *
+ * As for StPicoPhysicalHelix the magnetic field is in the internal units
+ * (B * kilogauss).
+ */
+
+#ifndef StPicoLiteHelix_h
+#define StPicoLiteHelix_h
+
+// C++ headers
+#include <cmath>
+#include <cfloat>
+#if !defined(__CINT__)
+#include <type_traits>
+#endif
+
+// ROOT headers
+#include "Rtypes.h"
+#include "TVector3.h"
+
+// PicoDst headers
+#ifdef _VANILLA_ROOT_
+#include "PhysicalConstants.h"
+#include "SystemOfUnits.h"
+#else
+#include "StarClassLibrary/PhysicalConstants.h"
+#include "StarClassLibrary/SystemOfUnits.h"
+#endif
+
+//_________________
+struct StPicoLiteHelix {
+
+  /// Origin (starting point) of the helix
+  Double_t originX;
+  Double_t originY;
+  Double_t originZ;
+  /// Curvature = 1/R in the xy-plane
+  Double_t curvature;
+  /// Dip angle
+  Double_t dipAngle;
+  /// Phase: azimuth in the xy-plane measured from the ring center
+  Double_t phase;
+  /// Cached trigonometric functions of the dip angle and phase
+  Double_t cosDipAngle;
+  Double_t sinDipAngle;
+  Double_t cosPhase;
+  Double_t sinPhase;
+  /// -sign(q*B)
+  Int_t    h;
+  /// 1 for straight lines (B=0), 0 otherwise
+  Int_t    isStraight;
+
+  /// Set the helix of a particle with momentum p, charge q at the origin o
+  /// in the field B (same as the StPicoPhysicalHelix constructor)
+  void set(const TVector3& p, const TVector3& o, Double_t B, Double_t q);
+
+  /// Value returned when there is no intersection with a plane
+  /// (same as StPicoHelix::NoSolution)
+  static Double_t noSolution()                          { return 3.e+33; }
+
+  /// Coordinates of the helix at the path length s
+  Double_t x(Double_t s) const;
+  Double_t y(Double_t s) const;
+  Double_t z(Double_t s) const                          { return originZ + s * sinDipAngle; }
+  void     at(Double_t s, Double_t& xAt, Double_t& yAt, Double_t& zAt) const
+  { xAt = x(s); yAt = y(s); zAt = z(s); }
+  TVector3 at(Double_t s) const                         { return TVector3( x(s), y(s), z(s) ); }
+  /// Origin as TVector3
+  TVector3 origin() const                               { return TVector3( originX, originY, originZ ); }
+
+  /// Center of the circle in the xy-plane
+  Double_t xcenter() const                              { return isStraight ? 0. : originX - cosPhase / curvature; }
+  Double_t ycenter() const                              { return isStraight ? 0. : originY - sinPhase / curvature; }
+
+  /// Period length of the helix
+  Double_t period() const;
+
+  /// Path length at the distance of closest approach in the xy-plane
+  Double_t pathLength(Double_t px, Double_t py) const;
+  /// Path length at the distance of closest approach to the point
+  Double_t pathLength(Double_t px, Double_t py, Double_t pz, Bool_t scanPeriods = true) const;
+  Double_t pathLength(const TVector3& p, Bool_t scanPeriods = true) const
+  { return pathLength( p.x(), p.y(), p.z(), scanPeriods ); }
+  /// Path length at the intersection with the plane through r with the normal n
+  Double_t pathLength(const TVector3& r, const TVector3& n) const;
+
+  /// Minimal distance between the point and the helix
+  Double_t distance(const TVector3& p, Bool_t scanPeriods = true) const;
+
+  /// Momentum at the path length s in the field B (zero for straight lines)
+  void     momentumAt(Double_t s, Double_t B, Double_t& px, Double_t& py, Double_t& pz) const;
+  TVector3 momentumAt(Double_t s, Double_t B) const;
+};
+
+#if !defined(__CINT__)
+static_assert( std::is_trivial<StPicoLiteHelix>::value &&
+               std::is_standard_layout<StPicoLiteHelix>::value,
+               "StPicoLiteHelix must stay a POD" );
+#endif
+
+//
+//     Inline functions
+//
+
+//_________________
+inline void StPicoLiteHelix::set(const TVector3& p, const TVector3& o, Double_t B, Double_t q) {
+
+  h = (q*B <= 0) ? 1 : -1;
+  if ( p.y() == 0 && p.x() == 0 ) {
+    phase = (M_PI/4)*(1-2.*h);
+  }
+  else {
+    phase = atan2( p.y(), p.x() ) - h*M_PI/2;
+  }
+  cosPhase = cos(phase);
+  sinPhase = sin(phase);
+  if ( ::fabs(phase) > M_PI ) {
+    phase = atan2(sinPhase, cosPhase);  // force range [-pi,pi]
+  }
+
+  dipAngle = atan2( p.z(), p.Perp() );
+  cosDipAngle = cos(dipAngle);
+  sinDipAngle = sin(dipAngle);
+
+  originX = o.x();
+  originY = o.y();
+  originZ = o.z();
+
+  {
+    using namespace units;
+    curvature = ::fabs( (c_light*nanosecond/meter*q*B/tesla) /
+                        ( p.Mag()/GeV*cosDipAngle ) / meter );
+  }
+  isStraight = ( curvature <= DBL_EPSILON ) ? 1 : 0;
+}
+
+//_________________
+inline Double_t StPicoLiteHelix::x(Double_t s) const {
+  if (isStraight)
+    return originX - s*cosDipAngle*sinPhase;
+  else
+    return originX + (cos(phase + s*h*curvature*cosDipAngle)-cosPhase)/curvature;
+}
+
+//_________________
+inline Double_t StPicoLiteHelix::y(Double_t s) const {
+  if (isStraight)
+    return originY + s*cosDipAngle*cosPhase;
+  else
+    return originY + (sin(phase + s*h*curvature*cosDipAngle)-sinPhase)/curvature;
+}
+
+//_________________
+inline Double_t StPicoLiteHelix::period() const {
+  if (isStraight) {
+    return DBL_MAX;
+  }
+  else {
+    return ::fabs( 2*M_PI/(h*curvature*cosDipAngle) );
+  }
+}
+
+//_________________
+inline Double_t StPicoLiteHelix::pathLength(Double_t px, Double_t py) const {
+
+  Double_t dx = px - originX;
+  Double_t dy = py - originY;
+  if (isStraight) {
+    return (dy*cosPhase - dx*sinPhase)/cosDipAngle;
+  }
+  else {
+    return atan2( dy*cosPhase - dx*sinPhase,
+                  1/curvature + dx*cosPhase + dy*sinPhase ) /
+      (h*curvature*cosDipAngle);
+  }
+}
+
+//_________________
+inline Double_t StPicoLiteHelix::pathLength(Double_t px, Double_t py, Double_t pz,
+                                            Bool_t scanPeriods) const {
+
+  // See StPicoHelix::pathLength(const TVector3&, Bool_t)
+  Double_t dx = px - originX;
+  Double_t dy = py - originY;
+  Double_t dz = pz - originZ;
+
+  if (isStraight) {
+    return cosDipAngle*(cosPhase*dy - sinPhase*dx) + sinDipAngle*dz;
+  }
+
+  const Double_t MaxPrecisionNeeded = units::micrometer;
+  const Int_t    MaxIterations      = 100;
+
+  Double_t t34 = curvature*cosDipAngle*cosDipAngle;
+  Double_t t41 = sinDipAngle*sinDipAngle;
+
+  // First guess from the dca in 2D, corrected by full periods
+  Double_t s = pathLength(px, py);
+
+  if (scanPeriods) {
+    Double_t ds = period();
+    Int_t jmin = 0;
+    Double_t xs, ys, zs;
+    at(s, xs, ys, zs);
+    Double_t dmin = ::sqrt( (xs-px)*(xs-px) + (ys-py)*(ys-py) + (zs-pz)*(zs-pz) );
+    for (Int_t j=1; j<MaxIterations; j++) {
+      at(s+j*ds, xs, ys, zs);
+      Double_t d = ::sqrt( (xs-px)*(xs-px) + (ys-py)*(ys-py) + (zs-pz)*(zs-pz) );
+      if ( d < dmin ) { dmin = d; jmin = j; }
+      else break;
+    }
+    for (Int_t j=-1; -j<MaxIterations; j--) {
+      at(s+j*ds, xs, ys, zs);
+      Double_t d = ::sqrt( (xs-px)*(xs-px) + (ys-py)*(ys-py) + (zs-pz)*(zs-pz) );
+      if ( d < dmin ) { dmin = d; jmin = j; }
+      else break;
+    }
+    if (jmin) {
+      s += jmin*ds;
+    }
+  } //if (scanPeriods)
+
+  // Newton's method
+  Double_t sOld = s;
+  for (Int_t i=0; i<MaxIterations; i++) {
+    Double_t t6  = phase + s*h*curvature*cosDipAngle;
+    Double_t t7  = cos(t6);
+    Double_t t11 = dx - (1/curvature)*(t7 - cosPhase);
+    Double_t t12 = sin(t6);
+    Double_t t19 = dy - (1/curvature)*(t12 - sinPhase);
+    s -= (t11*t12*h*cosDipAngle - t19*t7*h*cosDipAngle -
+          (dz - s*sinDipAngle)*sinDipAngle) /
+      (t12*t12*cosDipAngle*cosDipAngle + t11*t7*t34 +
+       t7*t7*cosDipAngle*cosDipAngle + t19*t12*t34 + t41);
+    if ( ::fabs(sOld - s) < MaxPrecisionNeeded ) break;
+    sOld = s;
+  }
+  return s;
+}
+
+//_________________
+inline Double_t StPicoLiteHelix::pathLength(const TVector3& r, const TVector3& n) const {
+
+  // See StPicoHelix::pathLength(const TVector3&, const TVector3&)
+  Double_t rn = (r.x() - originX)*n.x() + (r.y() - originY)*n.y() + (r.z() - originZ)*n.z();
+
+  if (isStraight) {
+    Double_t t = n.z()*sinDipAngle + n.y()*cosDipAngle*cosPhase - n.x()*cosDipAngle*sinPhase;
+    return ( t == 0 ) ? noSolution() : rn/t;
+  }
+
+  const Double_t MaxPrecisionNeeded = units::micrometer;
+  const Int_t    MaxIterations      = 20;
+
+  Double_t A = -curvature*rn - n.x()*cosPhase - n.y()*sinPhase;
+  Double_t t = h*curvature*cosDipAngle;
+  Double_t u = n.z()*curvature*sinDipAngle;
+
+  //  (cos(angMax)-1)/angMax = 0.1
+  const Double_t angMax = 0.21;
+  Double_t deltas = ::fabs( angMax/(curvature*cosDipAngle) );
+
+  Double_t s = 0;
+  Double_t sOld = 0;
+  for (Int_t i=0; i<MaxIterations; i++) {
+    Double_t a = t*s + phase;
+    Double_t sina = sin(a);
+    Double_t cosa = cos(a);
+    Double_t f = A + n.x()*cosa + n.y()*sina + u*s;
+    Double_t fp = -n.x()*sina*t + n.y()*cosa*t + u;
+    Double_t shift;
+    if ( ::fabs(fp)*deltas <= ::fabs(f) ) { //too big step
+      Int_t sgn = 1;
+      if (fp < 0.) sgn = -sgn;
+      if (f < 0.) sgn = -sgn;
+      shift = sgn*deltas;
+      if (shift < 0) shift *= 0.9;  // don't get stuck shifting +/-deltas
+    }
+    else {
+      shift = f/fp;
+    }
+    s -= shift;
+    if ( ::fabs(sOld - s) < MaxPrecisionNeeded ) return s;
+    sOld = s;
+  }
+  return noSolution();
+}
+
+//_________________
+inline Double_t StPicoLiteHelix::distance(const TVector3& p, Bool_t scanPeriods) const {
+  Double_t xs, ys, zs;
+  at( pathLength(p, scanPeriods), xs, ys, zs );
+  return ::sqrt( (xs-p.x())*(xs-p.x()) + (ys-p.y())*(ys-p.y()) + (zs-p.z())*(zs-p.z()) );
+}
+
+//_________________
+inline void StPicoLiteHelix::momentumAt(Double_t s, Double_t B,
+                                        Double_t& px, Double_t& py, Double_t& pz) const {
+  if (isStraight) {
+    px = 0; py = 0; pz = 0;
+    return;
+  }
+  using namespace units;
+  Double_t pt = GeV*::fabs(c_light*nanosecond/meter*B/tesla)/(::fabs(curvature)*meter);
+  // Phase of the origin moved to s (see StPicoHelix::moveOrigin)
+  Double_t phaseAt = phase + s*h*curvature*cosDipAngle;
+  px = pt*cos(phaseAt + h*M_PI/2);
+  py = pt*sin(phaseAt + h*M_PI/2);
+  pz = pt*tan(dipAngle);
+}
+
+//_________________
+inline TVector3 StPicoLiteHelix::momentumAt(Double_t s, Double_t B) const {
+  Double_t px, py, pz;
+  momentumAt(s, B, px, py, pz);
+  return TVector3(px, py, pz);
+}
+
+#endif
@@ -60,6 +60,11 @@ StPicoPhysicalHelix::StPicoPhysicalHelix(Double_t c, Double_t d,
   /* no-op */
 }
 
+//_________________
+StPicoPhysicalHelix::StPicoPhysicalHelix(const StPicoLiteHelix& h) : StPicoHelix(h) {
+  /* no-op */
+}
+
 //_________________
 TVector3 StPicoPhysicalHelix::momentum(Double_t B) const {
   
@@ -33,6 +33,8 @@ class StPicoPhysicalHelix : public StPicoHelix {
   /// Constructor with Curvature, dip angle, phase, origin, h
   StPicoPhysicalHelix(Double_t, Double_t, Double_t,
 		      const TVector3&, Int_t h=-1);
+  /// Constructor from the lightweight helix
+  StPicoPhysicalHelix(const StPicoLiteHelix&);
   /// Destructor
   ~StPicoPhysicalHelix();
 
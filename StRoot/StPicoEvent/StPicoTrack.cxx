@@ -202,7 +202,7 @@ void StPicoTrack::setNSigmaElectron(Float_t ns) {
 
 //_________________
 TVector3 StPicoTrack::gMom(TVector3 pVtx, Float_t const B) const {
-  StPicoPhysicalHelix gHelix = helix(B);
+  StPicoLiteHelix gHelix = liteHelix(B);
   return gHelix.momentumAt( gHelix.pathLength( pVtx ), B * kilogauss );
 }
 
@@ -212,6 +212,13 @@ StPicoPhysicalHelix StPicoTrack::helix(Float_t const B) const {
 			      static_cast<float>( charge() ) );
 }
 
+//_________________
+StPicoLiteHelix StPicoTrack::liteHelix(Float_t const B) const {
+  StPicoLiteHelix gHelix;
+  gHelix.set( gMom(), origin(), B * kilogauss, static_cast<float>( charge() ) );
+  return gHelix;
+}
+
 #if defined (__TFG__VERSION__)
 //_________________
 Float_t StPicoTrack::dEdxPull(Float_t mass, UChar_t fit, Int_t charge) const {
@@ -76,6 +76,8 @@ class StPicoTrack : public TObject {
   TVector3 gMom(TVector3 pVtx, Float_t B) const;
   /// Helix at point of DCA to StPicoEvent::mPrimaryVertex
   StPicoPhysicalHelix helix(Float_t const B) const;
+  /// Same helix as the lightweight POD (for hot loops and arrays)
+  StPicoLiteHelix liteHelix(Float_t const B) const;
 
   // Next functions return DCA (or its components) of the global track
   // to the point with coordinates (pVtxX, pVtxY, pVtxZ)
@@ -0,0 +1,111 @@
+//
+// StPicoTrackCovArrays decodes the track covariance matrices of an event into arrays
+//
+
+// C++ headers
+#include <algorithm>
+
+// ROOT headers
+#include "TClonesArray.h"
+
+// PicoDst headers
+#include "StPicoDst.h"
+#include "StPicoArrays.h"
+#include "StPicoTrackCovMatrix.h"
+#include "StPicoTrackCovArrays.h"
+
+//_________________
+StPicoTrackCovArrays::StPicoTrackCovArrays() : mSize(0), mStride(0), mBuffer(),
+                                               mBase(NULL), mIsGood() {
+  resize(0);
+}
+
+//_________________
+StPicoTrackCovArrays::~StPicoTrackCovArrays() {
+  /* empty */
+}
+
+//_________________
+void StPicoTrackCovArrays::resize(Int_t n) {
+
+  const Int_t nArrays = kNParams + kNCovElements;
+  // Multiple of 16 floats, so that every array starts at 64 bytes
+  const Int_t stride = ( (n > 0 ? n : 1) + 15 ) & ~15;
+  const size_t nFloats = (size_t)stride * nArrays + 16;
+
+  mSize = n;
+  if ( stride != mStride || mBuffer.size() < nFloats ) {
+    mStride = stride;
+    mBuffer.assign( nFloats, 0.f );
+    size_t address = reinterpret_cast<size_t>( &mBuffer[0] );
+    size_t shift = ( 64 - address % 64 ) % 64;
+    mBase = &mBuffer[0] + shift / sizeof(Float_t);
+  }
+  else {
+    std::fill( mBuffer.begin(), mBuffer.end(), 0.f );
+  }
+  mIsGood.assign( n, 0 );
+}
+
+//_________________
+Int_t StPicoTrackCovArrays::fill() {
+  return fill( StPicoDst::picoArray( StPicoArrays::TrackCovMatrix ) );
+}
+
+//_________________
+Int_t StPicoTrackCovArrays::fill(const TClonesArray *covMatrices) {
+
+  const Int_t n = ( covMatrices ) ? covMatrices->GetEntriesFast() : 0;
+  resize(n);
+  if ( n == 0 ) return 0;
+
+  Float_t *params[kNParams];
+  for (Int_t iPar=0; iPar<kNParams; iPar++) {
+    params[iPar] = mBase + iPar * mStride;
+  }
+  Float_t *cov[kNCovElements];
+  for (Int_t iEl=0; iEl<kNCovElements; iEl++) {
+    cov[iEl] = mBase + (kNParams + iEl) * mStride;
+  }
+
+  // Gather: parameters, sigmas into the diagonal and correlations
+  // into the off-diagonal elements
+  for (Int_t iTrk=0; iTrk<n; iTrk++) {
+    StPicoTrackCovMatrix *matrix = (StPicoTrackCovMatrix*)covMatrices->UncheckedAt(iTrk);
+    if ( !matrix ) continue;
+    const Float_t *lParams = matrix->params();
+    const Float_t *lSigma = matrix->sigmas();
+    const Float_t *lCorr = matrix->correlations();
+    for (Int_t iPar=0; iPar<kNParams; iPar++) {
+      params[iPar][iTrk] = lParams[iPar];
+    }
+    for (Int_t i=0; i<5; i++) {
+      cov[ covIndex(i, i) ][iTrk] = lSigma[i];
+      for (Int_t j=0; j<i; j++) {
+        cov[ covIndex(i, j) ][iTrk] = lCorr[ i * (i - 1) / 2 + j ];
+      }
+    }
+    mIsGood[iTrk] = matrix->isBadCovMatrix() ? 0 : 1;
+  }
+
+  // Covariances: corr(i,j)*sigma(i)*sigma(j), then the variances. Each
+  // loop runs over the tracks of one element and can be vectorized
+  for (Int_t i=0; i<5; i++) {
+    const Float_t *sigmaI = cov[ covIndex(i, i) ];
+    for (Int_t j=0; j<i; j++) {
+      const Float_t *sigmaJ = cov[ covIndex(j, j) ];
+      Float_t *element = cov[ covIndex(i, j) ];
+      for (Int_t iTrk=0; iTrk<n; iTrk++) {
+        element[iTrk] = element[iTrk] * sigmaI[iTrk] * sigmaJ[iTrk];
+      }
+    }
+  }
+  for (Int_t i=0; i<5; i++) {
+    Float_t *element = cov[ covIndex(i, i) ];
+    for (Int_t iTrk=0; iTrk<n; iTrk++) {
+      element[iTrk] *= element[iTrk];
+    }
+  }
+
+  return n;
+}
@@ -0,0 +1,106 @@
+/**
+ * \class StPicoTrackCovArrays
+ * \brief Per-event arrays of the track helix parameters and covariances
+ *
+ * Decodes all StPicoTrackCovMatrix objects of the event (the TrackCovMatrix
+ * branch, one entry per track) at once into structure-of-arrays form:
+ * the 6 parameters (imp, z, psi, pti, tan, curv) and the 15 elements of
+ * the packed symmetric 5x5 covariance matrix of (imp, z, psi, pti, tan).
+ * The covariance is packed as the lower triangle row by row (as in
+ * StDcaGeometry): element (i,j), j<=i, is at i*(i+1)/2+j, i.e.
+ *   0: imp-imp
+ *   1: z-imp     2: z-z
+ *   3: psi-imp   4: psi-z   5: psi-psi
+ *   6: pti-imp   7: pti-z   8: pti-psi   9: pti-pti
+ *  10: tan-imp  11: tan-z  12: tan-psi  13: tan-pti  14: tan-tan
+ *
+ * Each array holds stride() floats and starts at a 64-byte boundary, so
+ * the loops over tracks can use aligned vector loads. Entries past size()
+ * are zero.
+ *
+ *   StPicoTrackCovArrays cov;
+ *   cov.fill();                          // current event of StPicoDst
+ *   const Float_t *sImpImp = cov.cov(0);
+ *   for (Int_t i=0; i<cov.size(); i++) sigmaImp = sqrt( sImpImp[i] );
+ */
+
+#ifndef StPicoTrackCovArrays_h
+#define StPicoTrackCovArrays_h
+
+// C++ headers
+#include <vector>
+
+// ROOT headers
+#include "Rtypes.h"
+
+// Forward declarations
+class TClonesArray;
+
+//_________________
+class StPicoTrackCovArrays {
+
+ public:
+  /// Default constructor
+  StPicoTrackCovArrays();
+  /// Destructor
+  virtual ~StPicoTrackCovArrays();
+
+  /// Number of parameters and of packed covariance elements
+  enum { kNParams = 6, kNCovElements = 15 };
+  /// Parameters
+  enum EParam { kImp = 0, kZ = 1, kPsi = 2, kPti = 3, kTan = 4, kCurv = 5 };
+
+  /// Decode the TrackCovMatrix array of the current event in StPicoDst.
+  /// Returns the number of tracks
+  Int_t fill();
+  /// Decode the given array of StPicoTrackCovMatrix
+  Int_t fill(const TClonesArray *covMatrices);
+
+  /// Number of decoded tracks (same indexing as the tracks)
+  Int_t size() const                           { return mSize; }
+  /// Length of each array (size() rounded up to 16 floats)
+  Int_t stride() const                         { return mStride; }
+
+  /// Parameter array (see EParam)
+  const Float_t* param(Int_t iParam) const     { return mBase + iParam * mStride; }
+  const Float_t* imp() const                   { return param(kImp); }
+  const Float_t* z() const                     { return param(kZ); }
+  const Float_t* psi() const                   { return param(kPsi); }
+  const Float_t* pti() const                   { return param(kPti); }
+  const Float_t* tan() const                   { return param(kTan); }
+  const Float_t* curv() const                  { return param(kCurv); }
+
+  /// Array of the packed covariance element (0-14)
+  const Float_t* cov(Int_t iElement) const     { return mBase + (kNParams + iElement) * mStride; }
+  /// Covariance element (i,j) of the track, i,j = 0-4 (imp, z, psi, pti, tan)
+  Float_t covariance(Int_t iTrk, Int_t i, Int_t j) const
+  { return cov( covIndex(i, j) )[iTrk]; }
+  /// Packed index of the element (i,j)
+  static Int_t covIndex(Int_t i, Int_t j)
+  { return ( i >= j ) ? i * (i + 1) / 2 + j : j * (j + 1) / 2 + i; }
+
+  /// The track has a covariance matrix (not all values are zero,
+  /// see StPicoTrackCovMatrix::isBadCovMatrix)
+  Bool_t isGood(Int_t iTrk) const              { return mIsGood[iTrk] != 0; }
+
+ private:
+  /// Not copyable (mBase points into mBuffer)
+  StPicoTrackCovArrays(const StPicoTrackCovArrays&);
+  StPicoTrackCovArrays& operator=(const StPicoTrackCovArrays&);
+
+  /// Resize the buffer for n tracks
+  void resize(Int_t n);
+
+  /// Number of tracks
+  Int_t mSize;
+  /// Length of each array
+  Int_t mStride;
+  /// Storage of all arrays (with room for the alignment)
+  std::vector<Float_t> mBuffer;
+  /// First 64-byte aligned float of mBuffer
+  Float_t *mBase;
+  /// Covariance matrix is present
+  std::vector<UChar_t> mIsGood;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#!/bin/bash
+#
+# Runs the standard reader and skimmer benchmark scenarios and appends one
+# JSON line per scenario to the results file, tagged with the current git
+# commit, so the numbers can be compared commit by commit.
+#
+# Usage: run_benchmarks.sh [--input file.picoDst.root|file.list] [--events N]
+#                          [--threads N] [--results results.jsonl] [--no-skim]
+#
+# Without --input a synthetic picoDst is produced with macros/picoDstGenerator.
+# The skim scenarios need root4star and the compiled StRoot libraries
+# (cons in the repository top directory); they are skipped otherwise.
+
+set -e
+
+BENCHDIR=$(cd "$(dirname "$0")" && pwd)
+PICOPATH=$(cd "$BENCHDIR/.." && pwd)
+TOPDIR=$(cd "$PICOPATH/../.." && pwd)
+
+INPUT=""
+EVENTS=-1
+THREADS=4
+RESULTS="$BENCHDIR/results.jsonl"
+RUN_SKIM=1
+
+while [ $# -gt 0 ]; do
+  case "$1" in
+    --input)   INPUT="$2"; shift 2 ;;
+    --events)  EVENTS="$2"; shift 2 ;;
+    --threads) THREADS="$2"; shift 2 ;;
+    --results) RESULTS="$2"; shift 2 ;;
+    --no-skim) RUN_SKIM=0; shift ;;
+    *) echo "Unknown option: $1"; exit 1 ;;
+  esac
+done
+
+COMMIT=$(git -C "$TOPDIR" rev-parse --short HEAD 2>/dev/null || echo "unknown")
+HOST=$(hostname -s)
+
+# Keep only the JSON result lines and add commit/host information
+record() {
+  grep '^{"benchmark"' | sed "s/^{/{\"commit\":\"$COMMIT\",\"host\":\"$HOST\",/" | tee -a "$RESULTS"
+}
+
+# Build standalone library and benchmark executables
+make -C "$PICOPATH" > /dev/null
+make -C "$BENCHDIR" > /dev/null
+export LD_LIBRARY_PATH="$PICOPATH:$LD_LIBRARY_PATH"
+
+# Synthetic input if nothing was given
+if [ -z "$INPUT" ]; then
+  INPUT="$BENCHDIR/synthetic.picoDst.root"
+  if [ ! -f "$INPUT" ]; then
+    make -C "$PICOPATH/macros" picoDstGenerator > /dev/null
+    "$PICOPATH/macros/picoDstGenerator" "$INPUT" --events=200000 --runs=10 --seed=1 > /dev/null
+  fi
+fi
+INPUT=$(cd "$(dirname "$INPUT")" && pwd)/$(basename "$INPUT")
+
+echo "Benchmarking commit $COMMIT on $INPUT"
+
+# Reader scenarios
+for scenario in full event track; do
+  "$BENCHDIR/picoReadBenchmark" "$INPUT" $scenario $EVENTS 0 | record
+done
+"$BENCHDIR/picoReadBenchmark" "$INPUT" full $EVENTS $THREADS | record
+
+# Per-track accessor microbenchmarks
+"$BENCHDIR/picoMicroBenchmark" --json | record
+
+# Skimmer scenarios
+if [ $RUN_SKIM -eq 1 ]; then
+  if ! command -v root4star > /dev/null; then
+    echo "root4star not found: skim scenarios are skipped"
+    exit 0
+  fi
+  OUTFILE=/tmp/skimBenchmark_$$.root
+  cd "$TOPDIR"
+  for scenario in qa noqa mt; do
+    root4star -b -q -l "$BENCHDIR/runSkimBenchmark.C(\"$INPUT\",\"$OUTFILE\",\"$scenario\",$EVENTS,$THREADS)" 2>&1 | record
+    rm -f "$OUTFILE"
+  done
+fi
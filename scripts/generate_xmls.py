@@ -4,10 +4,14 @@ generate_xmls.py
 
 Create STAR scheduler XML files from the template in `templates/job_template.xml`.
 Features:
- - Fill placeholders: __BASEDIR__, __SRCDIR__, __GPFS_DEST__, __DAYTAG__, __OUTPREFIX__
+ - Fill placeholders: __BASEDIR__, __SRCDIR__, __GPFS_DEST__, __DAYTAG__, __OUTPREFIX__,
+   __SPLIT__ (maxFilesPerProcess, or nProcesses="1" for the per-job XMLs)
  - Accept either a catalog query string or a local filelist path
  - Toggle simulateSubmission (true/false)
- - Record git commit hash and copy a snapshot of `runPicoEASkim.C` into the output dir
+ - Record git commit hash and copy a snapshot of `runPicoEASkim.C` and
+   `picoEASkim.cfg` into the output dir
+ - Optionally (--balance-events) split a filelist into jobs of roughly equal
+   number of events and write one explicit filelist and one XML per job
 
 Usage examples in README_SUBMIT.md
 
@@ -17,6 +21,7 @@ import os
 import shutil
 import subprocess
 import datetime
+import math
 import sys
 
 
@@ -60,6 +65,118 @@ def build_input_element(args):
         raise RuntimeError('Either --input-catalog or --input-list must be provided')
 
 
+def read_filelist(path):
+    """Read a filelist; lines may be "file" or "file NumEvents" (the format
+    StPicoDstReader::Init tolerates). Returns [(file, entries or None)]."""
+    files = []
+    with open(path, 'r') as f:
+        for line in f:
+            fields = line.split()
+            if not fields or fields[0].startswith('#'):
+                continue
+            entries = None
+            if len(fields) > 1:
+                try:
+                    entries = int(fields[1])
+                except ValueError:
+                    entries = None
+            files.append((fields[0], entries))
+    return files
+
+
+def read_entries_cache(path):
+    """Cached metadata scan: "file NumEvents" per line"""
+    cache = {}
+    if not path or not os.path.isfile(path):
+        return cache
+    for name, entries in read_filelist(path):
+        if entries is not None:
+            cache[name] = entries
+    return cache
+
+
+def scan_entries(names):
+    """Number of PicoDst entries of each file, read with PyROOT"""
+    try:
+        import ROOT
+    except ImportError:
+        raise RuntimeError('--scan-entries needs PyROOT (set up the ROOT/STAR environment first)')
+    ROOT.gROOT.SetBatch(True)
+    result = {}
+    for i, name in enumerate(names):
+        f = ROOT.TFile.Open(name)
+        tree = f.Get('PicoDst') if f and not f.IsZombie() else None
+        if tree:
+            result[name] = int(tree.GetEntries())
+        else:
+            print(f'WARNING: cannot read PicoDst from {name}; the file is skipped', file=sys.stderr)
+            result[name] = 0
+        if f:
+            f.Close()
+        if (i + 1) % 100 == 0:
+            print(f'Scanned {i + 1}/{len(names)} files')
+    return result
+
+
+def file_entries(args):
+    """Entries of every file of --input-list from the list itself, the
+    cache and (optionally) a scan of the files without a known count.
+    New scan results are appended to the cache."""
+    files = read_filelist(args.input_list)
+    cache = read_entries_cache(args.entries_cache)
+    missing = [name for name, entries in files if entries is None and name not in cache]
+    if missing:
+        if not args.scan_entries:
+            raise RuntimeError(f'{len(missing)} files have no entry count in the filelist or in the '
+                               f'entries cache; pass --scan-entries to read them')
+        scanned = scan_entries(missing)
+        cache.update(scanned)
+        if args.entries_cache:
+            with open(args.entries_cache, 'a') as f:
+                for name in missing:
+                    f.write(f'{name} {scanned[name]}\n')
+    return [(name, entries if entries is not None else cache[name]) for name, entries in files]
+
+
+def split_balanced(files, events_per_job):
+    """Split files into contiguous jobs of roughly equal number of events.
+    The input order (e.g. by run) is kept; job k ends at the file boundary
+    closest to k * total / njobs, so a job deviates from the mean by at most
+    about one file. Files without entries are dropped."""
+    files = [(name, entries) for name, entries in files if entries > 0]
+    total = sum(entries for _, entries in files)
+    if not files:
+        return []
+    njobs = max(1, min(len(files), int(math.ceil(total / float(events_per_job)))))
+    jobs = []
+    current = []
+    cumulative = 0
+    for i, (name, entries) in enumerate(files):
+        boundary = (len(jobs) + 1) * total / float(njobs)
+        # close the job before this file if that ends closer to the boundary
+        if current and len(jobs) < njobs - 1 and \
+           abs(cumulative - boundary) <= abs(cumulative + entries - boundary):
+            jobs.append(current)
+            current = []
+        current.append((name, entries))
+        cumulative += entries
+    jobs.append(current)
+    return jobs
+
+
+def write_job_lists(jobs, list_dir):
+    """One explicit filelist per job, in the "file NumEvents" format"""
+    os.makedirs(list_dir, exist_ok=True)
+    paths = []
+    for i, job in enumerate(jobs):
+        path = os.path.join(list_dir, f'job_{i:04d}.list')
+        with open(path, 'w') as f:
+            for name, entries in job:
+                f.write(f'{name} {entries}\n')
+        paths.append(path)
+    return paths
+
+
 def main():
     parser = argparse.ArgumentParser(description='Generate STAR scheduler XML files for PicoEASkimmer')
     parser.add_argument('--output-dir', required=False, help='Optional explicit output dir; if omitted it will be derived from gpfs-base and daytag')
@@ -75,7 +192,15 @@ def main():
     group.add_argument('--input-list', help='Path to a local filelist (xrootd syntax)')
     parser.add_argument('--simulate', action='store_true', help='Set simulateSubmission="true" for dry-run')
     parser.add_argument('--xml-name', default=None, help='Optional explicit xml filename')
+    parser.add_argument('--balance-events', type=int, default=0, metavar='N',
+                        help='Split --input-list into jobs of about N events each, one filelist and one xml per job')
+    parser.add_argument('--entries-cache', default=None,
+                        help='Cached "file NumEvents" metadata scan used (and extended) by --balance-events')
+    parser.add_argument('--scan-entries', action='store_true',
+                        help='Read the entry counts missing from the filelist and the cache with PyROOT')
     args = parser.parse_args()
+    if args.balance_events > 0 and not args.input_list:
+        parser.error('--balance-events needs --input-list (or a "file NumEvents" list resolved from the catalog)')
 
     # derive gpfs destination and output dir from daytag if output-dir not provided
     if args.output_dir:
@@ -110,6 +235,9 @@ def main():
     steering_src = os.path.join(args.srcdir, 'runPicoEASkim.C')
     # write steering snapshot into the submission directory
     steering_snapshot = write_snapshot(steering_src, os.path.join(submission_dir, 'steering_snapshot'))
+    # and the cut configuration it loads
+    config_src = os.path.join(args.srcdir, 'picoEASkim.cfg')
+    config_snapshot = write_snapshot(config_src, os.path.join(submission_dir, 'steering_snapshot'))
 
     # fill placeholders
     day = args.daytag
@@ -121,6 +249,7 @@ def main():
     sandbox_files = []
     sandbox_files.append(f'      <File>file:{args.srcdir}/StRoot/</File>')
     sandbox_files.append(f'      <File>file:{args.srcdir}/runPicoEASkim.C</File>')
+    sandbox_files.append(f'      <File>file:{args.srcdir}/picoEASkim.cfg</File>')
     sandbox_files.append(f'      <File>file:{args.srcdir}/runlist2017.txt</File>')
     sl_dir = os.path.join(args.srcdir, '.sl73_gcc485')
     if os.path.isdir(sl_dir):
@@ -128,6 +257,15 @@ def main():
 
     sandbox_block = '\n'.join(sandbox_files)
 
+    # Event-balanced jobs: one explicit filelist per job
+    jobs = []
+    job_lists = []
+    if args.balance_events > 0:
+        jobs = split_balanced(file_entries(args), args.balance_events)
+        if not jobs:
+            raise RuntimeError('No input file with entries to split')
+        job_lists = write_job_lists(jobs, os.path.join(submission_dir, 'filelists'))
+
     base_subs = {
         '__BASEDIR__': basedir,
         '__SRCDIR__': args.srcdir,
@@ -137,19 +275,38 @@ def main():
         '__DAYTAG__': day,
         '__OUTPREFIX__': args.out_prefix,
         '__INPUT__': input_element,
+        '__SPLIT__': 'maxFilesPerProcess="120"',
         '__SIMULATE__': simulate_val,
         '__SANDBOX_FILES__': sandbox_block,
+        '__FILELIST__': '$FILELIST',
+        '__JOBTAG__': '$JOBINDEX',
     }
 
-    xml = tpl
-    for k, v in base_subs.items():
-        xml = xml.replace(k, v)
+    def fill(subs):
+        xml = tpl
+        for k, v in subs.items():
+            xml = xml.replace(k, v)
+        return xml
 
-    # write xml file
-    xml_name = args.xml_name or f'pico_ea_{day}.xml'
-    xml_path = os.path.join(submission_dir, xml_name)
-    with open(xml_path, 'w') as f:
-        f.write(xml)
+    xml_paths = []
+    xml_stem = os.path.splitext(args.xml_name or f'pico_ea_{day}.xml')[0]
+    if jobs:
+        # No scheduler input: each job runs exactly its own shipped filelist
+        for i, list_path in enumerate(job_lists):
+            subs = dict(base_subs)
+            subs['__INPUT__'] = ''
+            subs['__SPLIT__'] = 'nProcesses="1"'
+            subs['__FILELIST__'] = os.path.basename(list_path)
+            subs['__JOBTAG__'] = f'{i:04d}'
+            subs['__SANDBOX_FILES__'] = sandbox_block + f'\n      <File>file:{list_path}</File>'
+            xml_paths.append(os.path.join(submission_dir, f'{xml_stem}_{i:04d}.xml'))
+            with open(xml_paths[-1], 'w') as f:
+                f.write(fill(subs))
+    else:
+        xml_paths.append(os.path.join(submission_dir, f'{xml_stem}.xml'))
+        with open(xml_paths[-1], 'w') as f:
+            f.write(fill(base_subs))
+    xml_path = xml_paths[0]
 
     # write metadata file
     meta_path = os.path.join(submission_dir, f'METADATA_{day}.txt')
@@ -157,10 +314,22 @@ def main():
         f.write(f'generated: {datetime.datetime.utcnow().isoformat()}Z\n')
         f.write(f'git_commit: {commit}\n')
         f.write(f'steering_snapshot: {steering_snapshot or "<not-copied>"}\n')
-        f.write(f'xml: {xml_path}\n')
+        f.write(f'config_snapshot: {config_snapshot or "<not-copied>"}\n')
         f.write(f'input_element: {input_element}\n')
+        if jobs:
+            counts = [sum(entries for _, entries in job) for job in jobs]
+            f.write(f'balance_events: {args.balance_events}\n')
+            f.write(f'jobs: {len(jobs)} events: {sum(counts)} '
+                    f'min: {min(counts)} max: {max(counts)}\n')
+            for list_path, job, count in zip(job_lists, jobs, counts):
+                f.write(f'job: {os.path.basename(list_path)} files: {len(job)} events: {count}\n')
+        for path in xml_paths:
+            f.write(f'xml: {path}\n')
 
-    print('Wrote:', xml_path)
+    if jobs:
+        print(f'Wrote {len(xml_paths)} xmls ({xml_paths[0]} ... {xml_paths[-1]})')
+    else:
+        print('Wrote:', xml_path)
     print('Metadata:', meta_path)
     if steering_snapshot:
         print('Steering copied to:', steering_snapshot)
@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+"""
+local_runner.py
+
+Run a skim production on one node instead of the STAR scheduler.
+Features:
+ - Inputs: XML files generated by `generate_xmls.py` (filelist inputs or the
+   per-job filelists of --balance-events) and/or plain filelists
+ - N workers (one skim process each) pull tasks of --files-per-task files
+   from a shared work queue, so a fast worker simply takes more files (no
+   static split). With entry counts in the lists the largest files are
+   queued first
+ - Failed tasks are retried (--retries) and listed in the summary
+ - Each task runs `runPicoEASkim.C` with root or the native `picoEASkim`
+   executable (--executable); the outputs are merged with `picoEAMerge`
+   (or `hadd` when it is not built)
+
+Usage examples in README_SUBMIT.md
+
+"""
+import argparse
+import os
+import queue
+import shutil
+import subprocess
+import sys
+import threading
+import time
+import xml.etree.ElementTree as ET
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from generate_xmls import read_filelist
+
+
+REPO_DIR = os.path.abspath(os.path.join(os.path.dirname(__file__), '..'))
+
+
+def files_from_xml(path):
+    """Input files of a generated job XML: its filelist input, or the
+    explicit job filelist shipped in the sandbox (--balance-events)"""
+    root = ET.parse(path).getroot()
+    lists = []
+    for element in root.iter('input'):
+        url = element.get('URL', '')
+        if url.startswith('filelist:'):
+            lists.append(url[len('filelist:'):])
+        elif url.startswith('catalog:'):
+            raise RuntimeError(f'{path}: catalog inputs are not supported; '
+                               f'resolve the query into a filelist first')
+    for element in root.iter('File'):
+        url = (element.text or '').strip()
+        if url.startswith('file:') and url.endswith('.list'):
+            lists.append(url[len('file:'):])
+    if not lists:
+        raise RuntimeError(f'{path}: no filelist found')
+    files = []
+    for list_path in lists:
+        files.extend(read_filelist(list_path))
+    return files
+
+
+def collect_files(args):
+    xml_paths = []
+    for target in args.xml or []:
+        if os.path.isdir(target):
+            xml_paths.extend(sorted(os.path.join(target, name) for name in os.listdir(target)
+                                    if name.endswith('.xml')))
+        else:
+            xml_paths.append(target)
+    files = []
+    for path in xml_paths:
+        files.extend(files_from_xml(path))
+    for path in args.input_list or []:
+        files.extend(read_filelist(path))
+    # the same file may be in several lists
+    seen = set()
+    unique = []
+    for name, entries in files:
+        if name not in seen:
+            seen.add(name)
+            unique.append((name, entries))
+    return unique
+
+
+def make_tasks(files, files_per_task):
+    """Tasks of files_per_task files; the largest first when entries are
+    known, so that the tail of the production holds the small ones"""
+    if all(entries is not None for _, entries in files):
+        files = sorted(files, key=lambda f: f[1], reverse=True)
+    tasks = []
+    for i in range(0, len(files), files_per_task):
+        tasks.append(files[i:i + files_per_task])
+    return tasks
+
+
+def skim_command(args, list_path, out_path):
+    config = os.path.abspath(args.config)
+    if args.executable:
+        return [os.path.abspath(args.executable), f'--config={config}', list_path, out_path]
+    macro = os.path.join(REPO_DIR, 'runPicoEASkim.C')
+    call = f'{macro}("{list_path}","{out_path}",-1,0,-1.,false,"","{config}")'
+    return [args.root, '-q', '-b', '-l', call]
+
+
+class Runner:
+
+    def __init__(self, args, tasks):
+        self.args = args
+        self.tasks = tasks
+        self.work = queue.Queue()
+        self.lock = threading.Lock()
+        self.outputs = {}
+        self.failed = {}
+        self.attempts = 0
+        self.task_dir = os.path.join(args.workdir, 'tasks')
+        self.out_dir = os.path.join(args.workdir, 'outputs')
+        self.log_dir = os.path.join(args.workdir, 'logs')
+        for d in (self.task_dir, self.out_dir, self.log_dir):
+            os.makedirs(d, exist_ok=True)
+        for i in range(len(tasks)):
+            self.work.put((i, 1))
+
+    def run_task(self, i, attempt):
+        list_path = os.path.join(self.task_dir, f'task_{i:05d}.list')
+        out_path = os.path.join(self.out_dir, f'task_{i:05d}.root')
+        log_path = os.path.join(self.log_dir, f'task_{i:05d}.attempt{attempt}.log')
+        with open(list_path, 'w') as f:
+            for name, entries in self.tasks[i]:
+                f.write(f'{name} {entries}\n' if entries is not None else f'{name}\n')
+        if os.path.exists(out_path):
+            os.remove(out_path)
+        # run from the repository so that runlist2017.txt is found
+        with open(log_path, 'w') as log:
+            rc = subprocess.call(skim_command(self.args, list_path, out_path),
+                                 cwd=REPO_DIR, stdout=log, stderr=subprocess.STDOUT)
+        # root -q returns 0 also when the macro fails: require the output
+        if rc == 0 and (not os.path.isfile(out_path) or os.path.getsize(out_path) == 0):
+            rc = -1
+        return rc, out_path, log_path
+
+    def worker(self):
+        while True:
+            try:
+                i, attempt = self.work.get_nowait()
+            except queue.Empty:
+                return
+            rc, out_path, log_path = self.run_task(i, attempt)
+            with self.lock:
+                self.attempts += 1
+                if rc == 0:
+                    self.outputs[i] = out_path
+                    self.failed.pop(i, None)
+                    print(f'task {i:05d} done ({len(self.outputs)}/{len(self.tasks)})')
+                elif attempt <= self.args.retries:
+                    print(f'task {i:05d} failed (rc={rc}, {log_path}); retrying')
+                    self.work.put((i, attempt + 1))
+                else:
+                    self.failed[i] = log_path
+                    print(f'task {i:05d} failed (rc={rc}, {log_path}); giving up')
+
+    def run(self):
+        threads = [threading.Thread(target=self.worker) for _ in range(self.args.workers)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+
+
+def merge(args, outputs):
+    list_path = os.path.join(args.workdir, 'outputs.list')
+    with open(list_path, 'w') as f:
+        for path in outputs:
+            f.write(path + '\n')
+    merge_tool = args.merge_tool or os.path.join(REPO_DIR, 'StRoot', 'StPicoEASkimmer', 'macros', 'picoEAMerge')
+    if os.path.isfile(merge_tool):
+        report = os.path.join(args.workdir, 'merge_report.txt')
+        cmd = [merge_tool, args.output, f'@{list_path}', f'--threads={args.workers}', f'--report={report}']
+    elif shutil.which('hadd'):
+        print('picoEAMerge not found (make picoEAMerge in StRoot/StPicoEASkimmer/macros); using hadd')
+        cmd = ['hadd', '-f', '-j', str(args.workers), args.output] + outputs
+    else:
+        print('Neither picoEAMerge nor hadd found; outputs are listed in', list_path)
+        return 1
+    print('Merging:', ' '.join(cmd[:3]), '...')
+    return subprocess.call(cmd)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Run PicoEASkimmer jobs locally with a shared work queue')
+    parser.add_argument('--xml', action='append', help='Generated job XML or a directory of them (repeatable)')
+    parser.add_argument('--input-list', action='append', help='Filelist, "file" or "file NumEvents" lines (repeatable)')
+    parser.add_argument('--workdir', required=True, help='Directory for task lists, outputs and logs')
+    parser.add_argument('--output', default=None, help='Merged output (default: <workdir>/merged.root)')
+    parser.add_argument('--workers', type=int, default=os.cpu_count() or 1, help='Number of worker processes')
+    parser.add_argument('--files-per-task', type=int, default=1, help='Files a worker takes from the queue at once')
+    parser.add_argument('--retries', type=int, default=2, help='Retries of a failed task')
+    parser.add_argument('--config', default=os.path.join(REPO_DIR, 'picoEASkim.cfg'), help='Skim configuration file')
+    parser.add_argument('--executable', default=None, help='Native picoEASkim executable instead of the macro')
+    parser.add_argument('--root', default='root4star', help='ROOT command for the macro')
+    parser.add_argument('--merge-tool', default=None, help='picoEAMerge executable')
+    parser.add_argument('--no-merge', action='store_true', help='Keep the task outputs only')
+    args = parser.parse_args()
+    if not args.xml and not args.input_list:
+        parser.error('Either --xml or --input-list must be provided')
+    args.workdir = os.path.abspath(args.workdir)
+    args.output = os.path.abspath(args.output or os.path.join(args.workdir, 'merged.root'))
+    args.workers = max(1, args.workers)
+    args.files_per_task = max(1, args.files_per_task)
+
+    files = collect_files(args)
+    if not files:
+        raise RuntimeError('No input files')
+    tasks = make_tasks(files, args.files_per_task)
+    print(f'{len(files)} files in {len(tasks)} tasks, {args.workers} workers')
+
+    start = time.time()
+    runner = Runner(args, tasks)
+    runner.run()
+    elapsed = time.time() - start
+
+    events = sum(entries for i in runner.outputs for _, entries in tasks[i] if entries is not None)
+    print(f'Done: {len(runner.outputs)}/{len(tasks)} tasks in {elapsed:.0f} s '
+          f'({runner.attempts} attempts, {len(runner.failed)} failed)')
+    if events and elapsed > 0:
+        print(f'Throughput: {events} events, {events / elapsed:.1f} events/s')
+    for i, log_path in sorted(runner.failed.items()):
+        print(f'FAILED task {i:05d}: {log_path}')
+
+    rc = 0 if not runner.failed else 1
+    if runner.outputs and not args.no_merge:
+        outputs = [runner.outputs[i] for i in sorted(runner.outputs)]
+        if merge(args, outputs) != 0:
+            rc = 1
+        else:
+            print('Merged:', args.output)
+    return rc
+
+
+if __name__ == '__main__':
+    sys.exit(main())
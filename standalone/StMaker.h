@@ -0,0 +1,43 @@
+#ifndef StMaker_h
+#define StMaker_h
+
+// ROOT headers
+#include "TNamed.h"
+
+//________________
+/// Minimal stand-in for the STAR StMaker used by the standalone
+/// (_VANILLA_ROOT_) build of StPicoEASkimmer. It provides only what the
+/// skimmer needs without StChain: the Init/Make/Clear/Finish interface and
+/// the maker return codes. The native driver (picoEASkim.cxx) calls these
+/// methods in the same order as StChain does.
+
+/// Return codes of the makers (as in StTypeDefs.h)
+enum EReturnCodes {
+  kStOK = 0, kStOk = 0,
+  kStWarn = 1, kStWARN = 1,
+  kStEOF = 2, kStEof = 2,
+  kStErr = 3, kStERR = 3,
+  kStFatal = 4, kStFATAL = 4
+};
+
+class StMaker : public TNamed {
+
+ public:
+  /// Constructor
+  StMaker(const char *name = "", const char *title = "") : TNamed(name, title) { /* empty */ }
+  /// Destructor
+  virtual ~StMaker() { /* empty */ }
+
+  /// Called once before the event loop
+  virtual Int_t Init()                          { return kStOk; }
+  /// Called for every event
+  virtual Int_t Make()                          { return kStOk; }
+  /// Called before every event (keeps the name and title, unlike TNamed)
+  virtual void  Clear(Option_t * = "")          { /* empty */ }
+  /// Called once after the event loop
+  virtual Int_t Finish()                        { return kStOk; }
+
+  ClassDef(StMaker, 0)
+};
+
+#endif // StMaker_h
@@ -0,0 +1,136 @@
+/**
+ * \brief Native executable of the skim
+ *
+ * Runs StPicoEASkimmer without StChain and the STAR libraries: the input is
+ * read with StPicoDstReader and the skimmer is driven directly
+ * (Init, then Clear/Make per event until kStEOF, then Finish). The trigger
+ * selection and cuts are read from the same configuration file as in
+ * runPicoEASkim.C (picoEASkim.cfg by default), so the output is the same.
+ *
+ * Build with CMake from the repository top directory:
+ *   cmake -S . -B build -DPICOEA_NATIVE_ARCH=ON -DPICOEA_LTO=ON
+ *   cmake --build build -j
+ *
+ * Usage (same arguments as runPicoEASkim.C, run from the top directory so
+ * that runlist2017.txt is found):
+ *   ./build/picoEASkim [--config=file.cfg] input.list output.root [maxEvents]
+ *                      [checkpointInterval] [wallClockBudget] [resume] [augmentFileName]
+ *
+ * The input can also be a directory or a wildcard pattern of picoDst files.
+ * Options to read a slice of the input (see StPicoDstReader):
+ *   --file-shard=i/N    files of shard i of N (contiguous blocks of files)
+ *   --entry-shard=i/N   entries of shard i of N (of the entry range)
+ *   --entries=first:last  chain entries [first, last), last may be omitted
+ */
+
+// C++ headers
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+
+// ROOT headers
+#include "TChain.h"
+#include "TStopwatch.h"
+
+// StPicoEvent headers
+#include "StPicoEvent/StPicoDstReader.h"
+
+// StPicoEASkimmer headers
+#include "StPicoEASkimmer/StPicoEASkimmer.h"
+
+//_________________
+int main(int argc, char* argv[]) {
+
+  // Options first, then the positional arguments of runPicoEASkim.C
+  const char* configFileName = "picoEASkim.cfg";
+  Int_t fileShard = 0, nFileShards = 1;
+  Int_t entryShard = 0, nEntryShards = 1;
+  Long64_t firstEntry = 0, lastEntry = -1;
+  Bool_t isBadOption = false;
+  std::vector<const char*> args;
+  for (Int_t iArg=1; iArg<argc; iArg++) {
+    if ( std::strncmp( argv[iArg], "--config=", 9 ) == 0 ) configFileName = argv[iArg] + 9;
+    else if ( std::strncmp( argv[iArg], "--file-shard=", 13 ) == 0 ) {
+      isBadOption |= ( std::sscanf( argv[iArg] + 13, "%d/%d", &fileShard, &nFileShards ) != 2 );
+    }
+    else if ( std::strncmp( argv[iArg], "--entry-shard=", 14 ) == 0 ) {
+      isBadOption |= ( std::sscanf( argv[iArg] + 14, "%d/%d", &entryShard, &nEntryShards ) != 2 );
+    }
+    else if ( std::strncmp( argv[iArg], "--entries=", 10 ) == 0 ) {
+      isBadOption |= ( std::sscanf( argv[iArg] + 10, "%lld:%lld", &firstEntry, &lastEntry ) < 1 );
+    }
+    else args.push_back( argv[iArg] );
+  }
+
+  if ( args.size() < 2 || isBadOption ) {
+    std::cout << "Usage: picoEASkim [--config=file.cfg] [--file-shard=i/N] [--entry-shard=i/N]"
+              << " [--entries=first:last] inputFile outputFile [maxEvents]"
+              << " [checkpointInterval] [wallClockBudget] [resume] [augmentFileName]" << std::endl;
+    return -1;
+  }
+
+  const char* inFileName = args[0];
+  const char* outFileName = args[1];
+  Long64_t maxEvents = ( args.size() > 2 ) ? std::atoll( args[2] ) : -1;
+  Int_t checkpointInterval = ( args.size() > 3 ) ? std::atoi( args[3] ) : 0;
+  Double_t wallClockBudget = ( args.size() > 4 ) ? std::atof( args[4] ) : -1.;
+  Bool_t resume = ( args.size() > 5 ) ? ( std::atoi( args[5] ) != 0 ) : false;
+  const char* augmentFileName = ( args.size() > 6 ) ? args[6] : "";
+
+  // The skimmer reads the input itself
+  StPicoEASkimmer *anaMaker1 = new StPicoEASkimmer(inFileName, outFileName);
+  anaMaker1->setResume(resume);
+  anaMaker1->setCheckpointInterval(checkpointInterval);
+  anaMaker1->setWallClockBudget(wallClockBudget);
+  if ( augmentFileName[0] != '\0' ) {
+    anaMaker1->setAugmentFile(augmentFileName);
+  }
+  anaMaker1->setConfigFile(configFileName);
+  anaMaker1->picoDstReader()->setFileShard(fileShard, nFileShards);
+  anaMaker1->picoDstReader()->setEntryShard(entryShard, nEntryShards);
+  anaMaker1->picoDstReader()->setEntryRange(firstEntry, lastEntry);
+
+  if ( anaMaker1->Init() == kStErr ) {
+    std::cout << "Error during the skimmer initialization. Exit." << std::endl;
+    delete anaMaker1;
+    return -1;
+  }
+
+  Long64_t nEvents2Process = anaMaker1->picoDstReader()->numberOfEntries();
+  std::cout << " Number of events in files: " << nEvents2Process << std::endl;
+  if ( maxEvents > 0 && maxEvents < nEvents2Process ) {
+    std::cout << " Limiting processing to " << maxEvents << " events as requested." << std::endl;
+    nEvents2Process = maxEvents;
+  }
+
+  TStopwatch timer;
+  timer.Start();
+  Long64_t nEventsProcessed = 0;
+  Int_t status = 0;
+  for (Long64_t iEvent=0; iEvent<nEvents2Process; iEvent++) {
+    anaMaker1->Clear();
+    Int_t iret = anaMaker1->Make();
+    // End of input or wall-clock budget used up
+    if ( iret == kStEOF ) {
+      std::cout << "Stop after event: " << iEvent << std::endl;
+      break;
+    }
+    if ( iret ) {
+      std::cout << "Bad return code! " << iret << std::endl;
+      status = -1;
+      break;
+    }
+    nEventsProcessed++;
+  }
+  if ( anaMaker1->Finish() != kStOk ) {
+    status = -1;
+  }
+  timer.Stop();
+
+  std::cout << "Processed " << nEventsProcessed << " events in " << timer.RealTime()
+            << " s" << std::endl;
+  delete anaMaker1;
+  return status;
+}